@@ -5,53 +5,357 @@
  * This file provides the implementation of a stack data structure specifically designed to manage strings.
  * The stack grows dynamically as needed and supports basic stack operations such as push, pop, and size queries.
  *
- * The stack is internally represented by a structure (`_Stack`) that keeps track of the elements, the current 
+ * The stack is internally represented by a structure (`_Stack`) that keeps track of the elements, the current
  * stack size (`top`), and the allocated capacity. The stack can expand and shrink dynamically based on usage.
  *
  * ## Key Functions
- * - `stack_response create()`: Creates and initializes a new stack.
- * - `int size(const stack s)`: Returns the number of elements currently in the stack.
+ * - `stack_response create()`: Creates and initializes a new stack. Its element array is only allocated
+ *   by the first push, so a stack that is never pushed to costs a single allocation.
+ * - `stack_response create_with_allocator(const stack_allocator* allocator)`: Creates a stack whose memory
+ *   all comes from the given allocator hooks.
+ * - `size_t size(const stack s)`: Returns the number of elements currently in the stack.
  * - `bool is_empty(const stack s)`: Checks if the stack is empty.
  * - `bool is_full(const stack s)`: Checks if the stack has reached its maximum allowed capacity.
  * - `response_code push(stack s, char* item)`: Pushes a new string onto the stack. Resizes if needed.
  * - `string_response pop(stack s)`: Removes and returns the string at the top of the stack.
+ * - `push_many` / `pop_many`: Batch versions of push and pop that validate and reserve once per batch.
+ * - `concurrent_push` / `concurrent_pop`: Thread-safe push and pop on a `concurrent_stack`.
+ * - `shared_push` / `shared_pop`: Push and pop on a `shared_stack` shared between processes.
+ * - `durable_push` / `durable_pop`: Push and pop on a `durable_stack` whose contents survive crashes.
  * - `void destroy(stack* s)`: Frees all resources associated with the stack.
  *
  * ## Error Handling
- * - The stack operations return appropriate error codes for scenarios like memory allocation failure, exceeding 
+ * - The stack operations return appropriate error codes for scenarios like memory allocation failure, exceeding
  *   stack size limits, or attempting operations on an empty stack.
- * - Strings added to the stack are internally duplicated (`strdup`) to ensure ownership is managed by the stack.
+ * - Strings added to the stack are internally copied to ensure ownership is managed by the stack.
+ *
+ * ## Element Storage
+ * - Element copies are served from a slab allocator owned by the stack. Since no element may reach
+ *   `MAX_ELEMENT_BYTE_SIZE` bytes, every copy fits one of five size classes (16/32/64/128/256 bytes).
+ * - Each size class keeps a free list of slots carved out of `SLAB_BYTES` pages. Popped slots go back
+ *   on their free list and are recycled by later pushes instead of going back to the system allocator.
+ * - Slab pages are released only by `destroy()`, so a stack's footprint is bounded by its peak usage.
+ * - Each element slot is a 16-byte union. Strings shorter than `INLINE_ELEMENT_BYTES` are stored right in
+ *   the slot together with their length, so most pushes need no allocation and pops no pointer chase.
+ *   Longer strings keep a slab pointer and their length in the slot instead.
+ * - The stack never calls the system allocator directly. `create()` uses hooks backed by `malloc`, `realloc`
+ *   and `free`; `create_with_allocator()` substitutes the caller's hooks for the stack, its element array,
+ *   its slab pages and the strings handed out by `pop()`.
+ *
+ * ## Input Validation
+ * - Element lengths are found with a bounded scan that never looks past `MAX_ELEMENT_BYTE_SIZE` bytes, so
+ *   rejecting an enormous (or unterminated) input costs no more than accepting the longest legal one.
+ * - On x86 the scan runs 16 (SSE2) or 32 (AVX2) bytes at a time, picked at runtime from what the CPU
+ *   supports, with a portable scalar loop elsewhere. The vector scans read only aligned blocks, which
+ *   never straddle a page boundary, so they cannot fault on bytes past the terminator.
+ *
+ * ## Concurrency
+ * - A `concurrent_stack` holds plain heap copies of its elements behind a lock. `concurrent_push` copies its
+ *   string before locking and `concurrent_pop` hands the stored copy to the caller, so only the slot update
+ *   (and the rare resize) happens while the lock is held.
+ * - The lock is a three-state word (unlocked, locked, locked with sleepers). Threads first spin on it with
+ *   a pause hint, and only then mark it contended and sleep on a futex (or yield, off Linux). An unlock
+ *   makes a wake-up system call only when someone is actually asleep.
+ *
+ * ## Shared Memory
+ * - A `shared_stack` lives entirely inside a POSIX shared memory segment (`shm_open` + `mmap`), so several
+ *   processes on one host can push and pop on it directly. The segment holds a header with the lock, the
+ *   element slots, and an arena for long elements. Everything inside refers to everything else by offset
+ *   from the start of the segment, since each process may map it at a different address.
+ * - The segment is sized when it is created and never grows. Its arena has room for `capacity` elements
+ *   of every size class at once, so pushes below capacity never run out of arena space.
+ * - Access is serialized by a process-shared robust mutex in the header. If a process dies while holding
+ *   it, the next process to lock it is told so, marks it consistent and carries on; the stack stays
+ *   intact, though the arena slot of an element caught mid-push or mid-pop may be lost.
+ *
+ * ## Durability
+ * - A `durable_stack` keeps its elements in an ordinary stack and logs every push and pop to a journal
+ *   file as a checksummed record. Records are buffered and written out with one `fdatasync` per group
+ *   (group commit): after every operation, after a number of operations or a delay, or only when the
+ *   buffer fills or the stack is closed, depending on the chosen `sync_policy`.
+ * - Every `snapshot_interval` records the whole stack is written to a snapshot file, which atomically
+ *   replaces the previous one via rename, and the journal starts over. Recovery loads the snapshot and
+ *   replays at most one interval of journal records, so it is bounded by the interval.
+ * - Snapshots and journals carry a generation number. A journal left from before the latest snapshot
+ *   is recognized as stale and ignored, and replay stops at the first torn or corrupted record.
+ * - An operation whose record cannot be written is undone when the journal can be cut back to where it
+ *   was. When it cannot, or a snapshot cannot start a fresh journal, the operation stays applied but is
+ *   reported as failed, and every later operation writes a whole snapshot instead of a record until
+ *   one succeeds.
 */
+// syscall, and the futex and shared-memory calls, are not part of strict
+// ISO C, so ask for them before any header is read
+#define _GNU_SOURCE
+
 #include "string_stack.h"
 
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#else
+#include <sched.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#endif
+
 #define INITIAL_CAPACITY 16
 
+_Static_assert(MAX_CAPACITY >= INITIAL_CAPACITY, "MAX_CAPACITY is too small");
+_Static_assert(MAX_CAPACITY <= SIZE_MAX / 16, "MAX_CAPACITY exceeds the address space");
+
+#define SIZE_CLASS_COUNT 5
+#define MIN_SIZE_CLASS_BYTES 16
+#define SLAB_BYTES 4096
+
+#define LOCK_SPINS 128
+
+#define INLINE_ELEMENT_BYTES 15
+#define SLAB_ELEMENT 0xFF
+
+// A slab page is this header followed by slots of a single size class. The
+// header is padded so the slots that follow it stay 16-byte aligned.
+typedef union _Slab {
+    union _Slab* next;
+    char padding[MIN_SIZE_CLASS_BYTES];
+} slab;
+
+// A free slot holds the link to the next free slot of its class in place.
+typedef struct _FreeSlot {
+    struct _FreeSlot* next;
+} free_slot;
+
+// An element slot. Short strings live in `small.bytes` (terminator included)
+// with their length in the last byte of the slot. Longer strings live in a
+// slab slot; their pointer and length sit at the front and the last byte is
+// set to SLAB_ELEMENT to tell the two apart.
+typedef union {
+    struct {
+        char bytes[INLINE_ELEMENT_BYTES];
+        unsigned char length;
+    } small;
+    struct {
+        char* pointer;
+        unsigned short length;
+    } large;
+} element;
+
+_Static_assert(sizeof(element) == 16, "element slots must stay 16 bytes");
+
 // Complete your string stack implementation in this file.
 struct _Stack {
-    char** elements;
-    int top;
-    int capacity;
+    element* elements;
+    size_t top;
+    size_t capacity;
+    free_slot* free_lists[SIZE_CLASS_COUNT];
+    slab* slabs;
+    stack_allocator allocator;
 };
 
+static void* system_allocate(void* context, size_t bytes) {
+    (void)context;
+    return malloc(bytes);
+}
+
+static void* system_reallocate(void* context, void* pointer, size_t old_bytes, size_t new_bytes) {
+    (void)context;
+    (void)old_bytes;
+    return realloc(pointer, new_bytes);
+}
+
+static void system_deallocate(void* context, void* pointer, size_t bytes) {
+    (void)context;
+    (void)bytes;
+    free(pointer);
+}
+
+static const stack_allocator system_allocator = {
+    system_allocate, system_reallocate, system_deallocate, NULL
+};
+
+static void* allocate(const stack s, size_t bytes) {
+    return s->allocator.allocate(s->allocator.context, bytes);
+}
+
+static void* reallocate(const stack s, void* pointer, size_t old_bytes, size_t new_bytes) {
+    return s->allocator.reallocate(s->allocator.context, pointer, old_bytes, new_bytes);
+}
+
+static void deallocate(const stack s, void* pointer, size_t bytes) {
+    s->allocator.deallocate(s->allocator.context, pointer, bytes);
+}
+
+// Maps a byte count (terminator included) to the smallest size class that
+// holds it: 1..16 -> 0, 17..32 -> 1, ..., 129..256 -> 4.
+static int size_class_of(size_t bytes) {
+    int size_class = 0;
+    size_t class_bytes = MIN_SIZE_CLASS_BYTES;
+    while (class_bytes < bytes) {
+        class_bytes <<= 1;
+        size_class++;
+    }
+    return size_class;
+}
+
+// Carves a fresh slab page into free slots of the given class.
+static bool refill_size_class(stack s, int size_class) {
+    slab* page = allocate(s, SLAB_BYTES);
+    if (page == NULL) {
+        return false;
+    }
+    page->next = s->slabs;
+    s->slabs = page;
+
+    size_t slot_bytes = (size_t)MIN_SIZE_CLASS_BYTES << size_class;
+    char* end = (char*)page + SLAB_BYTES;
+    for (char* slot = (char*)(page + 1); slot + slot_bytes <= end; slot += slot_bytes) {
+        free_slot* node = (free_slot*)slot;
+        node->next = s->free_lists[size_class];
+        s->free_lists[size_class] = node;
+    }
+    return true;
+}
+
+static char* allocate_slot(stack s, size_t bytes) {
+    int size_class = size_class_of(bytes);
+    if (s->free_lists[size_class] == NULL && !refill_size_class(s, size_class)) {
+        return NULL;
+    }
+    free_slot* node = s->free_lists[size_class];
+    s->free_lists[size_class] = node->next;
+    return (char*)node;
+}
+
+static void release_slot(stack s, char* slot, size_t bytes) {
+    int size_class = size_class_of(bytes);
+    free_slot* node = (free_slot*)slot;
+    node->next = s->free_lists[size_class];
+    s->free_lists[size_class] = node;
+}
+
+// Each scan returns the length of `item` if its terminator is within the
+// first MAX_ELEMENT_BYTE_SIZE bytes, and MAX_ELEMENT_BYTE_SIZE otherwise.
+static size_t bounded_length_scalar(const char* item) {
+    size_t length = 0;
+    while (length < MAX_ELEMENT_BYTE_SIZE && item[length] != '\0') {
+        length++;
+    }
+    return length;
+}
+
+#ifdef HAVE_X86_SIMD
+// The first aligned block may start before `item`; the bits for those
+// bytes are shifted out of the mask. These reads stay inside pages that
+// `item` itself touches, but address sanitizers cannot know that.
+__attribute__((no_sanitize_address, target("sse2")))
+static size_t bounded_length_sse2(const char* item) {
+    size_t offset = (uintptr_t)item & 15;
+    const char* block = item - offset;
+    __m128i zero = _mm_setzero_si128();
+    unsigned mask = (unsigned)_mm_movemask_epi8(
+        _mm_cmpeq_epi8(_mm_load_si128((const __m128i*)block), zero)) >> offset;
+    if (mask != 0) {
+        return __builtin_ctz(mask);
+    }
+    for (size_t scanned = 16 - offset; scanned < MAX_ELEMENT_BYTE_SIZE; scanned += 16) {
+        block += 16;
+        mask = (unsigned)_mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_load_si128((const __m128i*)block), zero));
+        if (mask != 0) {
+            size_t length = scanned + __builtin_ctz(mask);
+            return length < MAX_ELEMENT_BYTE_SIZE ? length : MAX_ELEMENT_BYTE_SIZE;
+        }
+    }
+    return MAX_ELEMENT_BYTE_SIZE;
+}
+
+__attribute__((no_sanitize_address, target("avx2")))
+static size_t bounded_length_avx2(const char* item) {
+    size_t offset = (uintptr_t)item & 31;
+    const char* block = item - offset;
+    __m256i zero = _mm256_setzero_si256();
+    unsigned mask = (unsigned)_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(_mm256_load_si256((const __m256i*)block), zero)) >> offset;
+    if (mask != 0) {
+        return __builtin_ctz(mask);
+    }
+    for (size_t scanned = 32 - offset; scanned < MAX_ELEMENT_BYTE_SIZE; scanned += 32) {
+        block += 32;
+        mask = (unsigned)_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(_mm256_load_si256((const __m256i*)block), zero));
+        if (mask != 0) {
+            size_t length = scanned + __builtin_ctz(mask);
+            return length < MAX_ELEMENT_BYTE_SIZE ? length : MAX_ELEMENT_BYTE_SIZE;
+        }
+    }
+    return MAX_ELEMENT_BYTE_SIZE;
+}
+#endif
+
+static size_t bounded_length_dispatch(const char* item);
+
+// Starts out pointing at the dispatcher, which swaps in the best scan for
+// this CPU on first use. The pointer is atomic since every thread may do
+// that first call at once; relaxed order suffices because each of them
+// stores the same, immutable function.
+static size_t (*_Atomic bounded_length_scan)(const char* item) = bounded_length_dispatch;
+
+static inline size_t bounded_length(const char* item) {
+    return atomic_load_explicit(&bounded_length_scan, memory_order_relaxed)(item);
+}
+
+static size_t bounded_length_dispatch(const char* item) {
+    size_t (*scan)(const char* item) = bounded_length_scalar;
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        scan = bounded_length_avx2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        scan = bounded_length_sse2;
+    }
+#endif
+    atomic_store_explicit(&bounded_length_scan, scan, memory_order_relaxed);
+    return scan(item);
+}
+
 stack_response create() {
-    stack s = malloc(sizeof(struct _Stack));
+    return create_with_allocator(&system_allocator);
+}
+
+stack_response create_with_allocator(const stack_allocator* allocator) {
+    stack s = allocator->allocate(allocator->context, sizeof(struct _Stack));
     if (s == NULL) {
         return (stack_response){out_of_memory, NULL};
     }
+    s->allocator = *allocator;
     s->top = 0;
-    s->capacity = INITIAL_CAPACITY;
-    s->elements = malloc(INITIAL_CAPACITY * sizeof(char*));
-    if (s->elements == NULL) {
-        free(s);
-        return (stack_response){out_of_memory, NULL};
+    // No element array until the first push; see reserve_slots
+    s->elements = NULL;
+    s->capacity = 0;
+    for (int i = 0; i < SIZE_CLASS_COUNT; i++) {
+        s->free_lists[i] = NULL;
     }
+    s->slabs = NULL;
     return (stack_response){success, s};
 }
 
-int size(const stack s) {
+size_t size(const stack s) {
     return s->top;
 }
 
@@ -63,62 +367,1093 @@ bool is_full(const stack s) {
     return s->top == MAX_CAPACITY;
 }
 
+// Grows the element array, at most once, so it holds at least `needed`
+// elements. Capacity doubles as usual but never passes MAX_CAPACITY. A new
+// stack has no array at all (capacity 0), and gets its first one here.
+static response_code reserve_slots(stack s, size_t needed) {
+    if (needed <= s->capacity) {
+        return success;
+    }
+    size_t new_capacity = s->capacity == 0 ? INITIAL_CAPACITY : s->capacity;
+    while (new_capacity < needed) {
+        new_capacity *= 2;
+    }
+    if (new_capacity > MAX_CAPACITY) {
+        new_capacity = MAX_CAPACITY;
+    }
+
+    element* new_elements = s->capacity == 0
+        ? allocate(s, new_capacity * sizeof(element))
+        : reallocate(s, s->elements, s->capacity * sizeof(element), new_capacity * sizeof(element));
+    if (new_elements == NULL) {
+        return out_of_memory;
+    }
+    s->elements = new_elements;
+    s->capacity = new_capacity;
+    return success;
+}
+
+// Shrinks the element array, at most once, while the stack is no more than
+// a quarter full. Waiting for a quarter means alternating pushes and pops
+// around a capacity boundary do not thrash realloc.
+static void release_unused_slots(stack s) {
+    size_t new_capacity = s->capacity;
+    while (s->top <= new_capacity / 4 && new_capacity / 2 >= INITIAL_CAPACITY) {
+        new_capacity /= 2;
+    }
+    if (new_capacity == s->capacity) {
+        return;
+    }
+    element* new_elements = reallocate(s, s->elements,
+        s->capacity * sizeof(element), new_capacity * sizeof(element));
+    if (new_elements != NULL) {
+        s->elements = new_elements;
+        s->capacity = new_capacity;
+    }
+}
+
+// Copies an already validated string into the next free element slot.
+// The caller must have reserved room for it.
+static response_code store_element(stack s, const char* item, size_t length) {
+    element* slot = &s->elements[s->top];
+    if (length < INLINE_ELEMENT_BYTES) {
+        memcpy(slot->small.bytes, item, length);
+        slot->small.bytes[length] = '\0';
+        slot->small.length = (unsigned char)length;
+    } else {
+        char* copy = allocate_slot(s, length + 1);
+        if (copy == NULL) {
+            return out_of_memory;
+        }
+        memcpy(copy, item, length);
+        copy[length] = '\0';
+        slot->large.pointer = copy;
+        slot->large.length = (unsigned short)length;
+        slot->small.length = SLAB_ELEMENT;
+    }
+    s->top++;
+    return success;
+}
+
+// Drops every element above `new_top` without handing out copies, then
+// shrinks the element array if that left it sparse.
+static void discard_elements(stack s, size_t new_top) {
+    while (s->top > new_top) {
+        element* slot = &s->elements[--s->top];
+        if (slot->small.length == SLAB_ELEMENT) {
+            release_slot(s, slot->large.pointer, slot->large.length + 1);
+        }
+    }
+    release_unused_slots(s);
+}
+
+// Removes the top element, handing back a copy made with the allocator.
+static string_response take_element(stack s) {
+    element* slot = &s->elements[s->top - 1];
+    bool on_slab = slot->small.length == SLAB_ELEMENT;
+    char* bytes = on_slab ? slot->large.pointer : slot->small.bytes;
+    size_t length = on_slab ? slot->large.length : slot->small.length;
+    char* popped = allocate(s, length + 1);
+    if (popped == NULL) {
+        return (string_response){out_of_memory, NULL};
+    }
+    memcpy(popped, bytes, length + 1);
+    if (on_slab) {
+        release_slot(s, bytes, length + 1);
+    }
+    s->top--;
+    return (string_response){success, popped};
+}
+
 response_code push(stack s, char* item) {
-    
+
     if (is_full(s)) {
         return stack_full;
     }
 
-    if (strlen(item) >= MAX_ELEMENT_BYTE_SIZE) {
+    size_t length = bounded_length(item);
+    if (length >= MAX_ELEMENT_BYTE_SIZE) {
         return stack_element_too_large;
     }
 
-    if (s->top == s->capacity) {
-        int new_capacity = s->capacity * 2;
-        if (new_capacity > MAX_CAPACITY) {
-            new_capacity = MAX_CAPACITY;
+    response_code code = reserve_slots(s, s->top + 1);
+    if (code != success) {
+        return code;
+    }
+    return store_element(s, item, length);
+}
+
+response_code push_many(stack s, const char* const* items, const size_t* lens, size_t n, size_t* pushed) {
+    *pushed = 0;
+
+    size_t count = n;
+    if (count > MAX_CAPACITY - s->top) {
+        count = MAX_CAPACITY - s->top;
+    }
+    response_code code = reserve_slots(s, s->top + count);
+    if (code != success) {
+        return code;
+    }
+
+    // Each item is measured once, as it is stored. If a later one is too
+    // long, the items already stored are taken back off, so a bad element
+    // still never leaves half a batch behind. Items past a full stack are
+    // only checked.
+    size_t first = s->top;
+    for (size_t i = 0; i < n; i++) {
+        size_t length = lens != NULL ? lens[i] : bounded_length(items[i]);
+        if (length >= MAX_ELEMENT_BYTE_SIZE) {
+            discard_elements(s, first);
+            *pushed = 0;
+            return stack_element_too_large;
+        }
+        if (i < count) {
+            code = store_element(s, items[i], length);
+            if (code != success) {
+                return code;
+            }
+            (*pushed)++;
+        }
+    }
+    return count < n ? stack_full : success;
+}
+
+string_response pop(stack s) {
+    if (is_empty(s)) {
+        return (string_response){stack_empty, NULL};
+    }
+    string_response response = take_element(s);
+    if (response.code == success) {
+        release_unused_slots(s);
+    }
+    return response;
+}
+
+response_code pop_many(stack s, char** out, size_t n, size_t* popped) {
+    *popped = 0;
+    response_code code = success;
+    while (*popped < n) {
+        if (is_empty(s)) {
+            code = stack_empty;
+            break;
+        }
+        string_response response = take_element(s);
+        if (response.code != success) {
+            code = response.code;
+            break;
+        }
+        out[(*popped)++] = response.string;
+    }
+    release_unused_slots(s);
+    return code;
+}
+
+
+void destroy(stack* s) {
+    if (s == NULL || *s == NULL) {
+        return;
+    }
+    // Long element copies live inside the slab pages and short ones inside
+    // the slots, so freeing the pages releases every element at once.
+    slab* page = (*s)->slabs;
+    while (page != NULL) {
+        slab* next = page->next;
+        deallocate(*s, page, SLAB_BYTES);
+        page = next;
+    }
+    if ((*s)->elements != NULL) {
+        deallocate(*s, (*s)->elements, (*s)->capacity * sizeof(element));
+    }
+    // Copy the hooks out first, since they live inside the stack
+    stack_allocator allocator = (*s)->allocator;
+    allocator.deallocate(allocator.context, *s, sizeof(struct _Stack));
+    *s = NULL;
+}
+
+// Lock word states. A holder that finds LOCK_CONTENDED on release knows a
+// waiter may be asleep and must wake one.
+#define LOCK_FREE 0
+#define LOCK_HELD 1
+#define LOCK_CONTENDED 2
+
+struct _ConcurrentStack {
+    atomic_int lock;
+    char** elements;
+    size_t top;
+    size_t capacity;
+};
+
+static void cpu_relax() {
+#ifdef HAVE_X86_SIMD
+    _mm_pause();
+#endif
+}
+
+static void wait_on_lock(atomic_int* word) {
+#ifdef __linux__
+    syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, LOCK_CONTENDED, NULL, NULL, 0);
+#else
+    (void)word;
+    sched_yield();
+#endif
+}
+
+static void wake_lock_waiter(atomic_int* word) {
+#ifdef __linux__
+    syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#else
+    (void)word;
+#endif
+}
+
+static void lock(atomic_int* word) {
+    for (int spin = 0; spin < LOCK_SPINS; spin++) {
+        int expected = LOCK_FREE;
+        if (atomic_load_explicit(word, memory_order_relaxed) == LOCK_FREE &&
+            atomic_compare_exchange_weak_explicit(word, &expected, LOCK_HELD,
+                memory_order_acquire, memory_order_relaxed)) {
+            return;
         }
+        cpu_relax();
+    }
+    // Claim the lock as contended, since we cannot tell whether others are
+    // already asleep, and sleep until an unlock frees it.
+    while (atomic_exchange_explicit(word, LOCK_CONTENDED, memory_order_acquire) != LOCK_FREE) {
+        wait_on_lock(word);
+    }
+}
+
+static void unlock(atomic_int* word) {
+    if (atomic_exchange_explicit(word, LOCK_FREE, memory_order_release) == LOCK_CONTENDED) {
+        wake_lock_waiter(word);
+    }
+}
+
+concurrent_stack_response create_concurrent() {
+    concurrent_stack s = malloc(sizeof(struct _ConcurrentStack));
+    if (s == NULL) {
+        return (concurrent_stack_response){out_of_memory, NULL};
+    }
+    atomic_init(&s->lock, LOCK_FREE);
+    s->top = 0;
+    s->capacity = INITIAL_CAPACITY;
+    s->elements = malloc(INITIAL_CAPACITY * sizeof(char*));
+    if (s->elements == NULL) {
+        free(s);
+        return (concurrent_stack_response){out_of_memory, NULL};
+    }
+    return (concurrent_stack_response){success, s};
+}
+
+size_t concurrent_size(const concurrent_stack s) {
+    lock(&s->lock);
+    size_t top = s->top;
+    unlock(&s->lock);
+    return top;
+}
+
+response_code concurrent_push(concurrent_stack s, char* item) {
+    size_t length = bounded_length(item);
+    if (length >= MAX_ELEMENT_BYTE_SIZE) {
+        return stack_element_too_large;
+    }
+    char* copy = malloc(length + 1);
+    if (copy == NULL) {
+        return out_of_memory;
+    }
+    memcpy(copy, item, length + 1);
 
+    response_code code = success;
+    lock(&s->lock);
+    if (s->top == MAX_CAPACITY) {
+        code = stack_full;
+    } else if (s->top == s->capacity) {
+        size_t new_capacity = s->capacity * 2 < MAX_CAPACITY ? s->capacity * 2 : MAX_CAPACITY;
         char** new_elements = realloc(s->elements, new_capacity * sizeof(char*));
         if (new_elements == NULL) {
-            return out_of_memory;
+            code = out_of_memory;
+        } else {
+            s->elements = new_elements;
+            s->capacity = new_capacity;
         }
-        s->elements = new_elements;
-        s->capacity = new_capacity;
     }
+    if (code == success) {
+        s->elements[s->top++] = copy;
+    }
+    unlock(&s->lock);
 
-    s->elements[s->top++] = strdup(item);
-    return success;
+    if (code != success) {
+        free(copy);
+    }
+    return code;
 }
 
-string_response pop(stack s) {
-    if (is_empty(s)) {
+string_response concurrent_pop(concurrent_stack s) {
+    lock(&s->lock);
+    if (s->top == 0) {
+        unlock(&s->lock);
         return (string_response){stack_empty, NULL};
     }
-    char* popped = s-> elements[--s->top];
-    int new_capacity = s->capacity / 2;
-    if (new_capacity < 1) {
-        new_capacity = 1;
+    char* popped = s->elements[--s->top];
+    if (s->top <= s->capacity / 4 && s->capacity / 2 >= INITIAL_CAPACITY) {
+        char** new_elements = realloc(s->elements, s->capacity / 2 * sizeof(char*));
+        if (new_elements != NULL) {
+            s->elements = new_elements;
+            s->capacity /= 2;
+        }
     }
-    char** new_elements = realloc(s->elements, new_capacity * sizeof(char*));
-    if (new_elements == NULL) {
+    unlock(&s->lock);
+    return (string_response){success, popped};
+}
+
+void destroy_concurrent(concurrent_stack* s) {
+    if (s == NULL || *s == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < (*s)->top; i++) {
+        free((*s)->elements[i]);
+    }
+    free((*s)->elements);
+    free(*s);
+    *s = NULL;
+}
+
+#define SHARED_STACK_MAGIC 0x53545254u
+
+// Arena offsets are 32 bits, so a segment, which has room for 16 + 512
+// bytes of slots and arena per element, must stay under 4 GB.
+#define SHARED_CAPACITY_LIMIT (UINT32_MAX / 528)
+#define SHARED_MAX_CAPACITY \
+    (MAX_CAPACITY < SHARED_CAPACITY_LIMIT ? MAX_CAPACITY : SHARED_CAPACITY_LIMIT)
+#define NO_SHARED_SLOT 0
+
+// Like `element`, but a long string is found by its offset in the segment.
+typedef union {
+    struct {
+        char bytes[INLINE_ELEMENT_BYTES];
+        unsigned char length;
+    } small;
+    struct {
+        uint32_t offset;
+        unsigned short length;
+    } large;
+} shared_element;
+
+// The start of every shared segment. It is followed by `capacity` element
+// slots and then the arena, which is carved into size-class slots on
+// demand. Free arena slots hold the offset of the next free slot of their
+// class in their first four bytes.
+typedef struct {
+    uint32_t magic;
+    pthread_mutex_t lock;
+    size_t top;
+    size_t capacity;
+    uint32_t arena_next;
+    uint32_t arena_end;
+    uint32_t free_lists[SIZE_CLASS_COUNT];
+} shared_header;
+
+struct _SharedStack {
+    shared_header* header;
+    size_t mapped_bytes;
+};
+
+static shared_element* shared_elements(shared_header* header) {
+    return (shared_element*)(header + 1);
+}
+
+static size_t shared_segment_bytes(size_t capacity) {
+    // Room for `capacity` slots of each class: 16 + 32 + ... + 256 = 496
+    size_t arena_bytes = 0;
+    for (int size_class = 0; size_class < SIZE_CLASS_COUNT; size_class++) {
+        arena_bytes += capacity * ((size_t)MIN_SIZE_CLASS_BYTES << size_class);
+    }
+    return sizeof(shared_header) + capacity * sizeof(shared_element) + arena_bytes;
+}
+
+static uint32_t allocate_shared_slot(shared_header* header, size_t bytes) {
+    int size_class = size_class_of(bytes);
+    char* base = (char*)header;
+    uint32_t offset = header->free_lists[size_class];
+    if (offset != NO_SHARED_SLOT) {
+        memcpy(&header->free_lists[size_class], base + offset, sizeof(uint32_t));
+        return offset;
+    }
+    uint32_t slot_bytes = (uint32_t)MIN_SIZE_CLASS_BYTES << size_class;
+    if (header->arena_end - header->arena_next < slot_bytes) {
+        return NO_SHARED_SLOT;
+    }
+    offset = header->arena_next;
+    header->arena_next += slot_bytes;
+    return offset;
+}
+
+static void release_shared_slot(shared_header* header, uint32_t offset, size_t bytes) {
+    int size_class = size_class_of(bytes);
+    memcpy((char*)header + offset, &header->free_lists[size_class], sizeof(uint32_t));
+    header->free_lists[size_class] = offset;
+}
+
+// The lock is a process-shared robust mutex, so a process that dies while
+// holding it does not leave every other user blocked: the next locker is
+// told the owner died and takes the lock over.
+static bool init_shared_lock(pthread_mutex_t* mutex) {
+    pthread_mutexattr_t attributes;
+    if (pthread_mutexattr_init(&attributes) != 0) {
+        return false;
+    }
+    bool ok = pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED) == 0 &&
+              pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST) == 0 &&
+              pthread_mutex_init(mutex, &attributes) == 0;
+    pthread_mutexattr_destroy(&attributes);
+    return ok;
+}
+
+// Every update under the lock leaves the header and slots consistent at
+// each store, so when the owner died mid-operation the stack is still
+// usable; at worst the arena slot of the element it was pushing or popping
+// is never reused.
+static void lock_shared(shared_header* header) {
+    if (pthread_mutex_lock(&header->lock) == EOWNERDEAD) {
+        pthread_mutex_consistent(&header->lock);
+    }
+}
+
+static void unlock_shared(shared_header* header) {
+    pthread_mutex_unlock(&header->lock);
+}
+
+static shared_stack_response map_shared(int fd, size_t bytes) {
+    void* mapping = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return (shared_stack_response){stack_unavailable, NULL};
+    }
+    shared_stack s = malloc(sizeof(struct _SharedStack));
+    if (s == NULL) {
+        munmap(mapping, bytes);
+        return (shared_stack_response){out_of_memory, NULL};
+    }
+    s->header = mapping;
+    s->mapped_bytes = bytes;
+    return (shared_stack_response){success, s};
+}
+
+shared_stack_response create_shared(const char* name, size_t capacity) {
+    if (capacity == 0 || capacity > SHARED_MAX_CAPACITY) {
+        return (shared_stack_response){stack_unavailable, NULL};
+    }
+    size_t bytes = shared_segment_bytes(capacity);
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        return (shared_stack_response){stack_unavailable, NULL};
+    }
+    if (ftruncate(fd, (off_t)bytes) != 0) {
+        close(fd);
+        shm_unlink(name);
+        return (shared_stack_response){stack_unavailable, NULL};
+    }
+    shared_stack_response response = map_shared(fd, bytes);
+    if (response.code != success) {
+        shm_unlink(name);
+        return response;
+    }
+
+    // A fresh segment reads as zeros, so only the nonzero fields need
+    // setting. The magic number goes last to mark the header complete.
+    shared_header* header = response.stack->header;
+    if (!init_shared_lock(&header->lock)) {
+        close_shared(&response.stack);
+        shm_unlink(name);
+        return (shared_stack_response){stack_unavailable, NULL};
+    }
+    header->capacity = capacity;
+    header->arena_next = (uint32_t)(sizeof(shared_header) + capacity * sizeof(shared_element));
+    header->arena_end = (uint32_t)bytes;
+    atomic_thread_fence(memory_order_release);
+    header->magic = SHARED_STACK_MAGIC;
+    return response;
+}
+
+shared_stack_response open_shared(const char* name) {
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) {
+        return (shared_stack_response){stack_unavailable, NULL};
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 || (size_t)status.st_size < sizeof(shared_header)) {
+        close(fd);
+        return (shared_stack_response){stack_unavailable, NULL};
+    }
+    shared_stack_response response = map_shared(fd, (size_t)status.st_size);
+    if (response.code != success) {
+        return response;
+    }
+    // The segment must hold a finished stack header whose layout matches
+    // the size of the mapping.
+    shared_header* header = response.stack->header;
+    if (header->magic != SHARED_STACK_MAGIC || header->capacity == 0 ||
+        header->capacity > SHARED_MAX_CAPACITY ||
+        shared_segment_bytes(header->capacity) != response.stack->mapped_bytes) {
+        close_shared(&response.stack);
+        return (shared_stack_response){stack_unavailable, NULL};
+    }
+    return response;
+}
+
+size_t shared_size(const shared_stack s) {
+    lock_shared(s->header);
+    size_t top = s->header->top;
+    unlock_shared(s->header);
+    return top;
+}
+
+response_code shared_push(shared_stack s, char* item) {
+    size_t length = bounded_length(item);
+    if (length >= MAX_ELEMENT_BYTE_SIZE) {
+        return stack_element_too_large;
+    }
+
+    shared_header* header = s->header;
+    response_code code = success;
+    lock_shared(header);
+    if (header->top == header->capacity) {
+        code = stack_full;
+    } else {
+        shared_element* slot = &shared_elements(header)[header->top];
+        if (length < INLINE_ELEMENT_BYTES) {
+            memcpy(slot->small.bytes, item, length + 1);
+            slot->small.length = (unsigned char)length;
+        } else {
+            uint32_t offset = allocate_shared_slot(header, length + 1);
+            if (offset == NO_SHARED_SLOT) {
+                code = out_of_memory;
+            } else {
+                memcpy((char*)header + offset, item, length + 1);
+                slot->large.offset = offset;
+                slot->large.length = (unsigned short)length;
+                slot->small.length = SLAB_ELEMENT;
+            }
+        }
+        if (code == success) {
+            header->top++;
+        }
+    }
+    unlock_shared(header);
+    return code;
+}
+
+string_response shared_pop(shared_stack s) {
+    // Allocate the largest copy the element could need before locking, so
+    // the locked region holds no calls into the system allocator.
+    char* popped = malloc(MAX_ELEMENT_BYTE_SIZE);
+    if (popped == NULL) {
         return (string_response){out_of_memory, NULL};
     }
-    s->elements = new_elements;
-    s->capacity = new_capacity;
 
+    shared_header* header = s->header;
+    lock_shared(header);
+    if (header->top == 0) {
+        unlock_shared(header);
+        free(popped);
+        return (string_response){stack_empty, NULL};
+    }
+    shared_element* slot = &shared_elements(header)[--header->top];
+    if (slot->small.length == SLAB_ELEMENT) {
+        memcpy(popped, (char*)header + slot->large.offset, slot->large.length + 1);
+        release_shared_slot(header, slot->large.offset, slot->large.length + 1);
+    } else {
+        memcpy(popped, slot->small.bytes, slot->small.length + 1);
+    }
+    unlock_shared(header);
     return (string_response){success, popped};
 }
 
+void close_shared(shared_stack* s) {
+    if (s == NULL || *s == NULL) {
+        return;
+    }
+    munmap((*s)->header, (*s)->mapped_bytes);
+    free(*s);
+    *s = NULL;
+}
+
+void unlink_shared(const char* name) {
+    shm_unlink(name);
+}
+
+#define PATH_MAX_BYTES 4096
+#define SNAPSHOT_MAGIC 0x50414E53u
+#define JOURNAL_MAGIC 0x4C4E524Au
+#define JOURNAL_BUFFER_BYTES 65536
+#define PUSH_RECORD '+'
+#define POP_RECORD '-'
 
-void destroy(stack* s) {
+// Journal records are a type byte, a length byte, the element bytes (for
+// pushes) and a checksum of all of those. Headers are a magic number and
+// the generation of the snapshot the file goes with.
+#define RECORD_OVERHEAD (2 + sizeof(uint32_t))
+#define FILE_HEADER_BYTES (sizeof(uint32_t) + sizeof(uint64_t))
+
+static const durable_options default_durable_options = {sync_batched, 64, 1000, 65536};
+
+struct _DurableStack {
+    stack elements;
+    durable_options options;
+    char journal_path[PATH_MAX_BYTES];
+    char snapshot_path[PATH_MAX_BYTES];
+    char directory_path[PATH_MAX_BYTES];
+    int journal_fd;
+    bool journal_damaged;
+    uint64_t generation;
+    int records_since_snapshot;
+    int unsynced_records;
+    struct timespec first_unsynced;
+    size_t buffered;
+    unsigned char buffer[JOURNAL_BUFFER_BYTES];
+};
+
+// FNV-1a, which is plenty to catch torn and partially written records.
+static uint32_t checksum(const unsigned char* bytes, size_t length, uint32_t hash) {
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+#define CHECKSUM_SEED 2166136261u
+
+static bool write_all(int fd, const void* bytes, size_t length) {
+    const char* next = bytes;
+    while (length > 0) {
+        ssize_t written = write(fd, next, length);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        next += written;
+        length -= (size_t)written;
+    }
+    return true;
+}
+
+// Reads a whole file into a fresh buffer, refusing files over max_bytes.
+// A missing file is reported with a NULL buffer but success.
+static response_code read_file(const char* path, size_t max_bytes, unsigned char** bytes, size_t* length) {
+    *bytes = NULL;
+    *length = 0;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return errno == ENOENT ? success : stack_unavailable;
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 || (size_t)status.st_size > max_bytes) {
+        close(fd);
+        return stack_unavailable;
+    }
+    *bytes = malloc(status.st_size > 0 ? (size_t)status.st_size : 1);
+    if (*bytes == NULL) {
+        close(fd);
+        return out_of_memory;
+    }
+    while (*length < (size_t)status.st_size) {
+        ssize_t got = read(fd, *bytes + *length, (size_t)status.st_size - *length);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            break;
+        }
+        *length += (size_t)got;
+    }
+    close(fd);
+    return success;
+}
+
+// Flushes a file's data, and only as much metadata as reading it back needs.
+// Systems without fdatasync get the full fsync instead.
+static bool sync_data(int fd) {
+#ifdef __linux__
+    return fdatasync(fd) == 0;
+#else
+    return fsync(fd) == 0;
+#endif
+}
+
+static bool sync_directory(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    bool synced = fsync(fd) == 0;
+    close(fd);
+    return synced;
+}
+
+static void write_file_header(unsigned char* header, uint32_t magic, uint64_t generation) {
+    memcpy(header, &magic, sizeof magic);
+    memcpy(header + sizeof magic, &generation, sizeof generation);
+}
+
+// What became of the records being written out to the journal.
+typedef enum {
+    journal_written,    // In the file, and synced if that was asked for
+    journal_unchanged,  // Not in the file, and still buffered
+    journal_uncertain   // Not known to be on disk; left for the next snapshot
+} journal_outcome;
+
+// Writes the buffered records out and, if asked, syncs the journal. If
+// either step fails, the file is cut back to its old length, so that the
+// records provably are not in it and can stay buffered for another try.
+// Only if that fails too are they dropped, since writing them again could
+// replay them twice, and the journal is marked damaged: it may end in a
+// torn record that would hide anything appended after it.
+static journal_outcome flush_journal(durable_stack s, bool sync) {
+    off_t start = lseek(s->journal_fd, 0, SEEK_END);
+    if (start < 0) {
+        return journal_unchanged;
+    }
+    if (write_all(s->journal_fd, s->buffer, s->buffered) && (!sync || sync_data(s->journal_fd))) {
+        s->buffered = 0;
+        if (sync) {
+            s->unsynced_records = 0;
+        }
+        return journal_written;
+    }
+    if (ftruncate(s->journal_fd, start) == 0) {
+        return journal_unchanged;
+    }
+    s->buffered = 0;
+    s->journal_damaged = true;
+    return journal_uncertain;
+}
+
+static bool write_snapshot(durable_stack s);
+
+static bool sync_journal(durable_stack s) {
+    if (s->journal_damaged) {
+        return write_snapshot(s);
+    }
+    return flush_journal(s, true) == journal_written;
+}
+
+// Starts the journal file over, empty, for the current generation.
+static bool reset_journal(durable_stack s) {
+    unsigned char header[FILE_HEADER_BYTES];
+    write_file_header(header, JOURNAL_MAGIC, s->generation);
+    return ftruncate(s->journal_fd, 0) == 0 &&
+        write_all(s->journal_fd, header, sizeof header) &&
+        sync_data(s->journal_fd);
+}
+
+// Writes the whole stack, bottom first, to a new snapshot that replaces the
+// old one only once it is safely on disk, then starts a fresh journal. If
+// the journal cannot be started over, it stays damaged, since records for
+// the new generation would be ignored behind a missing or stale header.
+static bool write_snapshot(durable_stack s) {
+    stack elements = s->elements;
+    size_t bytes = FILE_HEADER_BYTES + sizeof(uint64_t) + sizeof(uint32_t) +
+        elements->top * (1 + MAX_ELEMENT_BYTE_SIZE);
+    unsigned char* image = malloc(bytes);
+    if (image == NULL) {
+        return false;
+    }
+    uint64_t generation = s->generation + 1;
+    uint64_t count = elements->top;
+    write_file_header(image, SNAPSHOT_MAGIC, generation);
+    size_t used = FILE_HEADER_BYTES;
+    memcpy(image + used, &count, sizeof count);
+    used += sizeof count;
+    for (size_t i = 0; i < elements->top; i++) {
+        element* slot = &elements->elements[i];
+        bool on_slab = slot->small.length == SLAB_ELEMENT;
+        size_t length = on_slab ? slot->large.length : slot->small.length;
+        image[used++] = (unsigned char)length;
+        memcpy(image + used, on_slab ? slot->large.pointer : slot->small.bytes, length);
+        used += length;
+    }
+    uint32_t sum = checksum(image, used, CHECKSUM_SEED);
+    memcpy(image + used, &sum, sizeof sum);
+    used += sizeof sum;
+
+    char temporary_path[PATH_MAX_BYTES + sizeof ".tmp"];
+    snprintf(temporary_path, sizeof temporary_path, "%s.tmp", s->snapshot_path);
+    int fd = open(temporary_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    bool written = fd >= 0 && write_all(fd, image, used) && fsync(fd) == 0;
+    if (fd >= 0) {
+        close(fd);
+    }
+    free(image);
+    if (!written || rename(temporary_path, s->snapshot_path) != 0) {
+        unlink(temporary_path);
+        return false;
+    }
+    // The new snapshot is in place and holds every buffered record, so the
+    // old journal is stale from here on
+    s->generation = generation;
+    s->buffered = 0;
+    s->unsynced_records = 0;
+    s->records_since_snapshot = 0;
+    bool synced = sync_directory(s->directory_path);
+    s->journal_damaged = !reset_journal(s) || !synced;
+    return !s->journal_damaged;
+}
+
+// Logs one operation, which has already been applied, and, depending on the
+// sync policy, commits the group of records logged so far with a single
+// fdatasync. Returns journal_unchanged only when the operation's record is
+// provably not in the journal, so that the caller can undo the operation,
+// and journal_uncertain when the operation stays applied but is not known
+// to be on disk. A snapshot that fails before replacing the old one does
+// not count: it is retried after the next operation.
+static journal_outcome append_record(durable_stack s, char type, const char* payload, size_t length) {
+    if (!s->journal_damaged && s->buffered + RECORD_OVERHEAD + length > JOURNAL_BUFFER_BYTES &&
+            flush_journal(s, false) == journal_unchanged) {
+        return journal_unchanged;
+    }
+    if (s->journal_damaged) {
+        // Nothing can be appended until a snapshot starts a new journal.
+        // The snapshot takes in this operation along with the rest.
+        return write_snapshot(s) ? journal_written : journal_uncertain;
+    }
+    size_t record_start = s->buffered;
+    unsigned char* record = s->buffer + record_start;
+    record[0] = (unsigned char)type;
+    record[1] = (unsigned char)length;
+    if (length > 0) {
+        memcpy(record + 2, payload, length);
+    }
+    uint32_t sum = checksum(record, 2 + length, CHECKSUM_SEED);
+    memcpy(record + 2 + length, &sum, sizeof sum);
+    s->buffered += RECORD_OVERHEAD + length;
+    s->records_since_snapshot++;
+    if (s->unsynced_records++ == 0) {
+        clock_gettime(CLOCK_MONOTONIC, &s->first_unsynced);
+    }
+
+    bool due = s->options.policy == sync_always;
+    if (s->options.policy == sync_batched) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long waited_us = (now.tv_sec - s->first_unsynced.tv_sec) * 1000000L +
+            (now.tv_nsec - s->first_unsynced.tv_nsec) / 1000;
+        due = s->unsynced_records >= s->options.group_commit_operations ||
+            waited_us >= s->options.group_commit_microseconds;
+    }
+    journal_outcome outcome = due ? flush_journal(s, true) : journal_written;
+    if (outcome == journal_unchanged) {
+        // The record is still the last one in the buffer; take it back out
+        s->buffered = record_start;
+        s->records_since_snapshot--;
+        s->unsynced_records--;
+        return journal_unchanged;
+    }
+    if (outcome == journal_written && s->options.snapshot_interval > 0 &&
+        s->records_since_snapshot >= s->options.snapshot_interval) {
+        write_snapshot(s);
+        if (s->journal_damaged) {
+            return journal_uncertain;
+        }
+    }
+    return outcome;
+}
+
+static response_code load_snapshot(durable_stack s) {
+    unsigned char* image;
+    size_t length;
+    // The contents are bounds-checked as they are parsed, so the file is not
+    // limited up front beyond what fits in memory.
+    response_code code = read_file(s->snapshot_path, SIZE_MAX, &image, &length);
+    if (code != success || image == NULL) {
+        return code;
+    }
+
+    uint32_t magic, sum;
+    uint64_t count;
+    code = stack_unavailable;
+    if (length >= FILE_HEADER_BYTES + sizeof count + sizeof sum) {
+        memcpy(&magic, image, sizeof magic);
+        memcpy(&s->generation, image + sizeof magic, sizeof s->generation);
+        memcpy(&count, image + FILE_HEADER_BYTES, sizeof count);
+        memcpy(&sum, image + length - sizeof sum, sizeof sum);
+        if (magic == SNAPSHOT_MAGIC && count <= MAX_CAPACITY &&
+            checksum(image, length - sizeof sum, CHECKSUM_SEED) == sum) {
+            code = success;
+        }
+    }
+    size_t next = FILE_HEADER_BYTES + sizeof count;
+    size_t end = length - sizeof sum;
+    char item[MAX_ELEMENT_BYTE_SIZE];
+    for (uint64_t i = 0; code == success && i < count; i++) {
+        size_t item_length = next < end ? image[next] : MAX_ELEMENT_BYTE_SIZE;
+        if (item_length >= MAX_ELEMENT_BYTE_SIZE || next + 1 + item_length > end) {
+            code = stack_unavailable;
+            break;
+        }
+        memcpy(item, image + next + 1, item_length);
+        item[item_length] = '\0';
+        next += 1 + item_length;
+        code = push(s->elements, item);
+    }
+    free(image);
+    return code;
+}
+
+// Replays the journal if it belongs to the loaded snapshot, cutting off any
+// torn tail, and leaves it open for appending. Otherwise starts a new one.
+static response_code recover_journal(durable_stack s) {
+    unsigned char* journal;
+    size_t length;
+    response_code code = read_file(s->journal_path, SIZE_MAX, &journal, &length);
+    if (code != success) {
+        return code;
+    }
+
+    size_t valid = 0;
+    uint32_t magic = 0;
+    uint64_t generation = 0;
+    if (journal != NULL && length >= FILE_HEADER_BYTES) {
+        memcpy(&magic, journal, sizeof magic);
+        memcpy(&generation, journal + sizeof magic, sizeof generation);
+    }
+    if (magic == JOURNAL_MAGIC && generation == s->generation) {
+        valid = FILE_HEADER_BYTES;
+        char item[MAX_ELEMENT_BYTE_SIZE];
+        while (length - valid >= RECORD_OVERHEAD) {
+            unsigned char* record = journal + valid;
+            size_t item_length = record[1];
+            uint32_t sum;
+            if (item_length >= MAX_ELEMENT_BYTE_SIZE || length - valid < RECORD_OVERHEAD + item_length) {
+                break;
+            }
+            memcpy(&sum, record + 2 + item_length, sizeof sum);
+            if (checksum(record, 2 + item_length, CHECKSUM_SEED) != sum) {
+                break;
+            }
+            if (record[0] == PUSH_RECORD) {
+                memcpy(item, record + 2, item_length);
+                item[item_length] = '\0';
+                if (push(s->elements, item) != success) {
+                    break;
+                }
+            } else if (record[0] == POP_RECORD && !is_empty(s->elements)) {
+                free(pop(s->elements).string);
+            } else {
+                break;
+            }
+            valid += RECORD_OVERHEAD + item_length;
+            s->records_since_snapshot++;
+        }
+    }
+    free(journal);
+
+    s->journal_fd = open(s->journal_path, O_WRONLY | O_CREAT | O_APPEND, 0600);
+    if (s->journal_fd < 0) {
+        return stack_unavailable;
+    }
+    if (valid == 0) {
+        return reset_journal(s) && sync_directory(s->directory_path) ? success : stack_unavailable;
+    }
+    return ftruncate(s->journal_fd, (off_t)valid) == 0 ? success : stack_unavailable;
+}
+
+durable_stack_response open_durable(const char* path, const durable_options* options) {
+    if (strlen(path) + sizeof ".snapshot" > PATH_MAX_BYTES) {
+        return (durable_stack_response){stack_unavailable, NULL};
+    }
+    durable_stack s = malloc(sizeof(struct _DurableStack));
+    if (s == NULL) {
+        return (durable_stack_response){out_of_memory, NULL};
+    }
+    s->options = options != NULL ? *options : default_durable_options;
+    s->journal_fd = -1;
+    s->journal_damaged = false;
+    s->generation = 0;
+    s->records_since_snapshot = 0;
+    s->unsynced_records = 0;
+    s->buffered = 0;
+    stack_response created = create();
+    s->elements = created.stack;
+    if (created.code != success) {
+        free(s);
+        return (durable_stack_response){out_of_memory, NULL};
+    }
+    snprintf(s->journal_path, PATH_MAX_BYTES, "%s.journal", path);
+    snprintf(s->snapshot_path, PATH_MAX_BYTES, "%s.snapshot", path);
+    const char* slash = strrchr(path, '/');
+    if (slash == NULL) {
+        strcpy(s->directory_path, ".");
+    } else if (slash == path) {
+        strcpy(s->directory_path, "/");
+    } else {
+        snprintf(s->directory_path, PATH_MAX_BYTES, "%.*s", (int)(slash - path), path);
+    }
+
+    response_code code = load_snapshot(s);
+    if (code == success) {
+        code = recover_journal(s);
+    }
+    if (code != success) {
+        close_durable(&s);
+        return (durable_stack_response){code, NULL};
+    }
+    return (durable_stack_response){success, s};
+}
+
+size_t durable_size(const durable_stack s) {
+    return size(s->elements);
+}
+
+response_code durable_push(durable_stack s, char* item) {
+    response_code code = push(s->elements, item);
+    if (code != success) {
+        return code;
+    }
+    element* slot = &s->elements->elements[s->elements->top - 1];
+    bool on_slab = slot->small.length == SLAB_ELEMENT;
+    journal_outcome outcome = append_record(s, PUSH_RECORD,
+        on_slab ? slot->large.pointer : slot->small.bytes,
+        on_slab ? slot->large.length : slot->small.length);
+    if (outcome == journal_unchanged) {
+        free(pop(s->elements).string);
+    }
+    return outcome == journal_written ? success : stack_unavailable;
+}
+
+string_response durable_pop(durable_stack s) {
+    string_response response = pop(s->elements);
+    if (response.code != success) {
+        return response;
+    }
+    journal_outcome outcome = append_record(s, POP_RECORD, NULL, 0);
+    if (outcome == journal_unchanged) {
+        push(s->elements, response.string);
+        free(response.string);
+        return (string_response){stack_unavailable, NULL};
+    }
+    // A pop that stays applied still hands over its string
+    return (string_response){outcome == journal_written ? success : stack_unavailable, response.string};
+}
+
+response_code durable_sync(durable_stack s) {
+    return sync_journal(s) ? success : stack_unavailable;
+}
+
+response_code durable_snapshot(durable_stack s) {
+    return write_snapshot(s) ? success : stack_unavailable;
+}
+
+void close_durable(durable_stack* s) {
     if (s == NULL || *s == NULL) {
         return;
     }
-    for (int i = 0; i < (*s)->top; i++) {
-        free((*s)->elements[i]);
+    if ((*s)->journal_fd >= 0) {
+        sync_journal(*s);
+        close((*s)->journal_fd);
     }
-    free((*s)->elements); 
+    destroy(&(*s)->elements);
     free(*s);
     *s = NULL;
 }
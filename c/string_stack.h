@@ -11,8 +11,14 @@
 
 // Not needed for C23, but needed for C17 and below.
 #include <stdbool.h>
+#include <stddef.h>
 
+// The ceiling can be raised, up to what the address space can hold, by
+// defining MAX_CAPACITY when compiling both the stack and its callers,
+// e.g. -DMAX_CAPACITY=4294967296. Sizes and indices are all size_t.
+#ifndef MAX_CAPACITY
 #define MAX_CAPACITY 32768
+#endif
 #define MAX_ELEMENT_BYTE_SIZE 256
 
 // Make the representation of the stack unknown to code that uses it
@@ -23,7 +29,8 @@ typedef enum {
   out_of_memory,
   stack_element_too_large,
   stack_full,
-  stack_empty
+  stack_empty,
+  stack_unavailable
 } response_code;
 
 // Result object for operations returning a stack. If the stack was
@@ -44,22 +51,158 @@ typedef struct {
     char* string;
 } string_response;
 
+// Memory hooks for a stack. Every allocation the stack makes, including
+// the copies of its elements and of popped strings, goes through these
+// functions with `context` passed back as the first argument. This lets
+// callers route a stack's memory to an arena, a per-request pool, or a
+// test allocator. Sizes are passed to reallocate and deallocate so that
+// sized allocators do not need to track them.
+typedef struct {
+    void* (*allocate)(void* context, size_t bytes);
+    void* (*reallocate)(void* context, void* pointer, size_t old_bytes, size_t new_bytes);
+    void (*deallocate)(void* context, void* pointer, size_t bytes);
+    void* context;
+} stack_allocator;
+
 // Note that since stacks are large, we always pass pointers to them.
 // But some of the operations do not mutate the stack, so we mark the
 // parameter const. Remember that the typedef 'stack' is a pointer type!
 // The strings themselves are defensively copied in and out of the stack.
 
 stack_response create();                  // Must destroy() returned stack
+stack_response create_with_allocator(const stack_allocator* allocator);
+                                          // Same, but all memory comes from
+                                          // the allocator, which is copied
 
-int size(const stack s);
+size_t size(const stack s);
 bool is_empty(const stack s);
 bool is_full(const stack s);              // If at MAX_CAPACITY
 
 response_code push(stack s, char* item);  // Stores copy of string inside stack
 string_response pop(stack s);             // Will include a copy of the string
                                           // from the stack, so the caller is
-                                          // responsible for freeing it
+                                          // responsible for freeing it (with
+                                          // the stack's allocator, when given
+                                          // one, as deallocate(ctx, p, len+1))
+
+// Batch operations. push_many copies items in order, using lens[i] as the
+// length of items[i] (lens may be NULL to measure them). Each length is
+// measured once, and an oversized element rejects the whole batch, leaving
+// the stack as it was. If the stack fills up part way, the items that fit are
+// pushed and stack_full is returned. pop_many pops up to n strings into
+// out, top first, returning stack_empty if the stack ran out early. Both
+// report how many elements they moved through their last argument.
+response_code push_many(stack s, const char* const* items, const size_t* lens, size_t n, size_t* pushed);
+response_code pop_many(stack s, char** out, size_t n, size_t* popped);
 
 void destroy(stack* s);                   // frees *all* the memory
 
+// A thread-safe stack of strings. Any number of threads may push and pop
+// on the same concurrent_stack. Element copies are made before its lock
+// is taken, and popped strings are handed over without copying, so the
+// locked region is little more than a pointer swap. The lock spins
+// briefly and then sleeps, so waiting threads do not burn a core.
+typedef struct _ConcurrentStack* concurrent_stack;
+
+typedef struct {
+    response_code code;
+    concurrent_stack stack;
+} concurrent_stack_response;
+
+concurrent_stack_response create_concurrent();    // Must destroy_concurrent()
+
+size_t concurrent_size(const concurrent_stack s);
+
+response_code concurrent_push(concurrent_stack s, char* item);
+string_response concurrent_pop(concurrent_stack s);   // Caller frees string
+
+void destroy_concurrent(concurrent_stack* s);     // Not while others use it
+
+// A stack of strings in POSIX shared memory, which processes on the same
+// host can push and pop on concurrently. The first process creates it
+// under a name (which must start with a slash) with a fixed capacity no
+// larger than MAX_CAPACITY (nor about 8 million, as segments address their
+// contents with 32-bit offsets); the others open it by that name. Each handle
+// only maps the segment, so closing a handle leaves the stack in place
+// until the name is unlinked and every process has closed it. Creating
+// or opening fails with stack_unavailable when the segment cannot be
+// made or mapped, or does not hold a stack. A process that dies in the
+// middle of a push or pop does not block the others.
+typedef struct _SharedStack* shared_stack;
+
+typedef struct {
+    response_code code;
+    shared_stack stack;
+} shared_stack_response;
+
+shared_stack_response create_shared(const char* name, size_t capacity);
+shared_stack_response open_shared(const char* name);
+
+size_t shared_size(const shared_stack s);
+
+response_code shared_push(shared_stack s, char* item);
+string_response shared_pop(shared_stack s);       // Caller frees string
+
+void close_shared(shared_stack* s);               // Unmaps this handle only
+void unlink_shared(const char* name);             // Removes the name
+
+// A stack of strings whose contents survive crashes. Its state lives in
+// two files next to `path`: path.snapshot and path.journal. Opening a
+// durable stack recovers whatever was committed before the last close or
+// crash. The options trade latency for durability:
+//
+//   sync_always   Each push and pop is on disk before it returns.
+//   sync_batched  Operations are committed in groups that share one
+//                 fdatasync, once group_commit_operations have piled up
+//                 or the oldest has waited group_commit_microseconds
+//                 (checked on the next operation; durable_sync() commits
+//                 an idle stack). A crash loses at most one group.
+//   sync_never    The OS writes the journal back when it likes. A crash
+//                 of the process loses at most the buffer, of the host
+//                 anything not yet written back.
+//
+// Every snapshot_interval operations (0 for never) the stack is written
+// to a fresh snapshot and the journal starts over, which bounds recovery
+// time. Passing NULL options selects sync_batched, 64 operations, 1000
+// microseconds and a snapshot every 65536 operations. File errors are
+// reported as stack_unavailable. A push or pop that fails this way has
+// usually been undone, and its record is not in the journal. If the journal
+// was left in a state where that cannot be known, or could not be started
+// over after a snapshot, the operation instead stays applied (a pop still
+// returns its string, to be freed) and each later operation writes a full
+// snapshot, reporting stack_unavailable until one succeeds. A snapshot that
+// cannot be written at all does not fail the operation that triggered it,
+// and is retried on the next one.
+typedef struct _DurableStack* durable_stack;
+
+typedef struct {
+    response_code code;
+    durable_stack stack;
+} durable_stack_response;
+
+typedef enum {
+    sync_never,
+    sync_batched,
+    sync_always
+} sync_policy;
+
+typedef struct {
+    sync_policy policy;
+    int group_commit_operations;
+    int group_commit_microseconds;
+    int snapshot_interval;
+} durable_options;
+
+durable_stack_response open_durable(const char* path, const durable_options* options);
+
+size_t durable_size(const durable_stack s);
+
+response_code durable_push(durable_stack s, char* item);
+string_response durable_pop(durable_stack s);     // Caller frees string
+
+response_code durable_sync(durable_stack s);      // Commits pending operations
+response_code durable_snapshot(durable_stack s);  // Compacts the journal now
+
+void close_durable(durable_stack* s);             // Commits, then frees memory
+
 #endif
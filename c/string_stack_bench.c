@@ -0,0 +1,488 @@
+// Benchmarks for the string stack. Build with optimizations, e.g.
+//
+//     gcc -O2 -pthread string_stack.c string_stack_bench.c && ./a.out
+//
+// The large-scale run needs a raised ceiling and about 16 bytes of memory
+// per element, e.g. for 2^31 elements:
+//
+//     gcc -O2 -pthread -DMAX_CAPACITY=4294967296 string_stack.c string_stack_bench.c
+//     ./a.out large 2147483648
+//
+// Each benchmark runs a workload against the stack and against a baseline
+// that manages its strings directly with the system allocator, and prints
+// nanoseconds per operation and how much the resident set size grew.
+
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "string_stack.h"
+
+// -----------------------------------------------------------------------------
+static double now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Current (not peak) resident set size in kilobytes.
+static long resident_kb() {
+    long pages = 0;
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (statm == NULL) return 0;
+    if (fscanf(statm, "%*s %ld", &pages) != 1) pages = 0;
+    fclose(statm);
+    return pages * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static void report(const char* name, double elapsed_ns, long ops, long rss_kb) {
+    printf("%-40s %8.1f ns/op %8ld KB rss\n", name, elapsed_ns / ops, rss_kb);
+}
+
+static void report_time(const char* name, double elapsed_ns, long ops) {
+    printf("%-40s %8.1f ns/op\n", name, elapsed_ns / ops);
+}
+
+// Deterministic mix of lengths: mostly short strings with a long tail, so
+// every size class sees traffic.
+#define WORKLOAD_STRINGS 4096
+static char workload[WORKLOAD_STRINGS][MAX_ELEMENT_BYTE_SIZE];
+
+static void build_workload() {
+    unsigned seed = 12345;
+    for (int i = 0; i < WORKLOAD_STRINGS; i++) {
+        seed = seed * 1103515245 + 12345;
+        int length = (seed >> 16) % 4 == 0 ? (seed >> 8) % 255 : (seed >> 8) % 24;
+        memset(workload[i], 'a' + i % 26, length);
+        workload[i][length] = '\0';
+    }
+}
+// -----------------------------------------------------------------------------
+
+// Fills to a depth, then churns pops and pushes around it so freed element
+// memory is reused by strings of different lengths. The resident set growth
+// after the stack is destroyed shows how much memory stayed fragmented.
+#define CHURN_DEPTH 16384
+#define CHURN_ROUNDS 64
+
+static void bench_mixed_churn() {
+    long ops = 0;
+    long rss_before = resident_kb();
+    double start = now_ns();
+    stack s = create().stack;
+    for (int round = 0; round < CHURN_ROUNDS; round++) {
+        while (size(s) < CHURN_DEPTH) {
+            push(s, workload[(ops++ + round) % WORKLOAD_STRINGS]);
+        }
+        while (size(s) > CHURN_DEPTH / 2) {
+            free(pop(s).string);
+            ops++;
+        }
+    }
+    long rss_peak = resident_kb() - rss_before;
+    destroy(&s);
+    report("slab stack mixed churn", now_ns() - start, ops, rss_peak);
+    printf("%-40s %8ld KB rss\n", "  retained after destroy", resident_kb() - rss_before);
+
+    ops = 0;
+    rss_before = resident_kb();
+    start = now_ns();
+    char** elements = malloc(CHURN_DEPTH * sizeof(char*));
+    int top = 0;
+    for (int round = 0; round < CHURN_ROUNDS; round++) {
+        while (top < CHURN_DEPTH) {
+            elements[top++] = strdup(workload[(ops++ + round) % WORKLOAD_STRINGS]);
+        }
+        while (top > CHURN_DEPTH / 2) {
+            // Mirror pop(): a copy goes out and the stored string is freed
+            char* popped = strdup(elements[--top]);
+            free(elements[top]);
+            free(popped);
+            ops++;
+        }
+    }
+    rss_peak = resident_kb() - rss_before;
+    while (top > 0) free(elements[--top]);
+    free(elements);
+    report("strdup mixed churn", now_ns() - start, ops, rss_peak);
+    printf("%-40s %8ld KB rss\n", "  retained after free", resident_kb() - rss_before);
+}
+
+// A bump allocator hands out memory by advancing an offset into one big
+// buffer and frees nothing individually; the whole arena is reset at once.
+// That suits short-lived stacks, such as one per request.
+#define ARENA_BYTES (1 << 20)
+#define SHORT_LIVED_STACKS 100000
+#define SHORT_LIVED_DEPTH 64
+
+typedef struct {
+    char* memory;
+    size_t used;
+} bump_arena;
+
+static void* bump_allocate(void* context, size_t bytes) {
+    bump_arena* arena = context;
+    size_t start = (arena->used + 15) & ~(size_t)15;
+    if (start + bytes > ARENA_BYTES) return NULL;
+    arena->used = start + bytes;
+    return arena->memory + start;
+}
+
+static void* bump_reallocate(void* context, void* pointer, size_t old_bytes, size_t new_bytes) {
+    void* moved = bump_allocate(context, new_bytes);
+    if (moved != NULL) memcpy(moved, pointer, old_bytes < new_bytes ? old_bytes : new_bytes);
+    return moved;
+}
+
+static void bump_deallocate(void* context, void* pointer, size_t bytes) {
+    (void)context;
+    (void)pointer;
+    (void)bytes;
+}
+
+static void bench_short_lived_stacks() {
+    long ops = 0;
+    double start = now_ns();
+    for (int i = 0; i < SHORT_LIVED_STACKS; i++) {
+        stack s = create().stack;
+        for (int j = 0; j < SHORT_LIVED_DEPTH; j++) {
+            push(s, workload[ops++ % WORKLOAD_STRINGS]);
+        }
+        while (!is_empty(s)) {
+            free(pop(s).string);
+            ops++;
+        }
+        destroy(&s);
+    }
+    report_time("short-lived stacks, system allocator", now_ns() - start, ops);
+
+    bump_arena arena = {malloc(ARENA_BYTES), 0};
+    stack_allocator bump = {bump_allocate, bump_reallocate, bump_deallocate, &arena};
+    ops = 0;
+    start = now_ns();
+    for (int i = 0; i < SHORT_LIVED_STACKS; i++) {
+        stack s = create_with_allocator(&bump).stack;
+        for (int j = 0; j < SHORT_LIVED_DEPTH; j++) {
+            push(s, workload[ops++ % WORKLOAD_STRINGS]);
+        }
+        while (!is_empty(s)) {
+            pop(s);
+            ops++;
+        }
+        destroy(&s);
+        arena.used = 0;
+    }
+    report_time("short-lived stacks, bump allocator", now_ns() - start, ops);
+    free(arena.memory);
+}
+
+// Stacks that are created and mostly never pushed to, as when one is set up
+// per request or per graph vertex. The hooks count calls into the allocator.
+#define UNUSED_STACKS 1000000
+#define CHURN_PUSH_EVERY 8
+
+static long allocator_calls;
+
+static void* counted_allocate(void* context, size_t bytes) {
+    (void)context;
+    allocator_calls++;
+    return malloc(bytes);
+}
+
+static void* counted_reallocate(void* context, void* pointer, size_t old_bytes, size_t new_bytes) {
+    (void)context;
+    (void)old_bytes;
+    allocator_calls++;
+    return realloc(pointer, new_bytes);
+}
+
+static void counted_deallocate(void* context, void* pointer, size_t bytes) {
+    (void)context;
+    (void)bytes;
+    allocator_calls++;
+    free(pointer);
+}
+
+static void bench_unused_stacks() {
+    stack_allocator counted = {counted_allocate, counted_reallocate, counted_deallocate, NULL};
+    stack* stacks = malloc(UNUSED_STACKS * sizeof(stack));
+    long rss_before = resident_kb();
+    allocator_calls = 0;
+    double start = now_ns();
+    for (int i = 0; i < UNUSED_STACKS; i++) {
+        stacks[i] = create_with_allocator(&counted).stack;
+    }
+    report("create unused stacks", now_ns() - start, UNUSED_STACKS, resident_kb() - rss_before);
+    printf("%-40s %8.2f calls/stack\n", "  allocator calls", (double)allocator_calls / UNUSED_STACKS);
+    for (int i = 0; i < UNUSED_STACKS; i++) {
+        destroy(&stacks[i]);
+    }
+    free(stacks);
+
+    allocator_calls = 0;
+    start = now_ns();
+    for (int i = 0; i < UNUSED_STACKS; i++) {
+        stack s = create_with_allocator(&counted).stack;
+        if (i % CHURN_PUSH_EVERY == 0) {
+            push(s, workload[i % WORKLOAD_STRINGS]);
+            free(pop(s).string);
+        }
+        destroy(&s);
+    }
+    report_time("create and destroy, 1 in 8 pushed", now_ns() - start, UNUSED_STACKS);
+    printf("%-40s %8.2f calls/stack\n", "  allocator calls", (double)allocator_calls / UNUSED_STACKS);
+}
+
+// Pushes and pops in groups, one call per element versus one per group.
+#define BATCH_SIZE 256
+#define BATCH_ROUNDS 4000
+
+static void bench_batches() {
+    const char* items[BATCH_SIZE];
+    size_t lens[BATCH_SIZE];
+    char* out[BATCH_SIZE];
+    for (int i = 0; i < BATCH_SIZE; i++) {
+        items[i] = workload[i];
+        lens[i] = strlen(workload[i]);
+    }
+
+    stack s = create().stack;
+    long ops = 0;
+    double start = now_ns();
+    for (int round = 0; round < BATCH_ROUNDS; round++) {
+        for (int i = 0; i < BATCH_SIZE; i++) push(s, (char*)items[i]);
+        for (int i = 0; i < BATCH_SIZE; i++) out[i] = pop(s).string;
+        for (int i = 0; i < BATCH_SIZE; i++) free(out[i]);
+        ops += 2 * BATCH_SIZE;
+    }
+    report_time("single push/pop", now_ns() - start, ops);
+
+    size_t moved;
+    ops = 0;
+    start = now_ns();
+    for (int round = 0; round < BATCH_ROUNDS; round++) {
+        push_many(s, items, lens, BATCH_SIZE, &moved);
+        pop_many(s, out, BATCH_SIZE, &moved);
+        for (int i = 0; i < BATCH_SIZE; i++) free(out[i]);
+        ops += 2 * BATCH_SIZE;
+    }
+    report_time("push_many/pop_many", now_ns() - start, ops);
+    destroy(&s);
+}
+
+// Rejecting an oversized input should cost no more than pushing the
+// longest legal element, however long the input is. The strlen baseline
+// shows what the old unbounded check paid for a 1 MB input.
+#define HUGE_INPUT_BYTES (1 << 20)
+#define LENGTH_CHECK_ROUNDS 200000
+
+static void bench_length_checks() {
+    char* huge = malloc(HUGE_INPUT_BYTES + 1);
+    memset(huge, 'x', HUGE_INPUT_BYTES);
+    huge[HUGE_INPUT_BYTES] = '\0';
+    char longest[MAX_ELEMENT_BYTE_SIZE];
+    memset(longest, 'x', MAX_ELEMENT_BYTE_SIZE - 1);
+    longest[MAX_ELEMENT_BYTE_SIZE - 1] = '\0';
+
+    stack s = create().stack;
+    double start = now_ns();
+    for (int i = 0; i < LENGTH_CHECK_ROUNDS; i++) {
+        push(s, longest);
+        free(pop(s).string);
+    }
+    report_time("push+pop of longest legal element", now_ns() - start, LENGTH_CHECK_ROUNDS);
+
+    start = now_ns();
+    for (int i = 0; i < LENGTH_CHECK_ROUNDS; i++) push(s, huge);
+    report_time("rejecting a 1 MB element", now_ns() - start, LENGTH_CHECK_ROUNDS);
+
+    size_t total = 0;
+    start = now_ns();
+    for (int i = 0; i < LENGTH_CHECK_ROUNDS / 1000; i++) {
+        total += strlen(huge + (i & 1));
+    }
+    report_time("strlen of a 1 MB element (baseline)", now_ns() - start, LENGTH_CHECK_ROUNDS / 1000);
+    if (total == 0) printf("unreachable\n");
+    destroy(&s);
+    free(huge);
+}
+
+// Threads share one stack and each does pushes followed by pops. The
+// baseline is a plain stack behind a pthread mutex held for the whole call,
+// copies included, which is how callers had to share a stack before.
+#define SCALING_OPERATIONS 400000
+#define MAX_SCALING_THREADS 64
+
+typedef struct {
+    concurrent_stack concurrent;
+    stack plain;
+    pthread_mutex_t* mutex;
+    int operations;
+} scaling_job;
+
+static void* concurrent_job(void* argument) {
+    scaling_job* job = argument;
+    for (int i = 0; i < job->operations; i += 32) {
+        for (int j = 0; j < 16; j++) concurrent_push(job->concurrent, workload[(i + j) % WORKLOAD_STRINGS]);
+        for (int j = 0; j < 16; j++) free(concurrent_pop(job->concurrent).string);
+    }
+    return NULL;
+}
+
+static void* mutex_job(void* argument) {
+    scaling_job* job = argument;
+    for (int i = 0; i < job->operations; i += 32) {
+        for (int j = 0; j < 16; j++) {
+            pthread_mutex_lock(job->mutex);
+            push(job->plain, workload[(i + j) % WORKLOAD_STRINGS]);
+            pthread_mutex_unlock(job->mutex);
+        }
+        for (int j = 0; j < 16; j++) {
+            pthread_mutex_lock(job->mutex);
+            char* popped = pop(job->plain).string;
+            pthread_mutex_unlock(job->mutex);
+            free(popped);
+        }
+    }
+    return NULL;
+}
+
+static double run_threads(void* (*body)(void*), scaling_job* job, int threads) {
+    pthread_t workers[MAX_SCALING_THREADS];
+    double start = now_ns();
+    for (int i = 0; i < threads; i++) pthread_create(&workers[i], NULL, body, job);
+    for (int i = 0; i < threads; i++) pthread_join(workers[i], NULL);
+    return now_ns() - start;
+}
+
+static void bench_thread_scaling() {
+    pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    char name[64];
+    for (int threads = 1; threads <= MAX_SCALING_THREADS; threads *= 2) {
+        scaling_job job = {create_concurrent().stack, create().stack, &mutex,
+            SCALING_OPERATIONS / threads};
+        snprintf(name, sizeof name, "concurrent_stack, %d threads", threads);
+        report_time(name, run_threads(concurrent_job, &job, threads), SCALING_OPERATIONS);
+        snprintf(name, sizeof name, "mutex around stack, %d threads", threads);
+        report_time(name, run_threads(mutex_job, &job, threads), SCALING_OPERATIONS);
+        destroy_concurrent(&job.concurrent);
+        destroy(&job.plain);
+    }
+}
+
+// Worker processes open one shared stack by name and each run a share of
+// a fixed number of pushes and pops on it.
+#define SHARED_OPERATIONS 400000
+#define MAX_SHARED_PROCESSES 16
+
+static void bench_shared_processes() {
+    char name[64];
+    snprintf(name, sizeof name, "/string_stack_bench_%d", (int)getpid());
+    shared_stack s = create_shared(name, MAX_CAPACITY).stack;
+    if (s == NULL) {
+        printf("shared memory unavailable, skipping\n");
+        return;
+    }
+    char label[64];
+    for (int processes = 1; processes <= MAX_SHARED_PROCESSES; processes *= 2) {
+        int operations = SHARED_OPERATIONS / processes;
+        double start = now_ns();
+        for (int p = 0; p < processes; p++) {
+            if (fork() == 0) {
+                shared_stack mine = open_shared(name).stack;
+                for (int i = 0; i < operations; i += 32) {
+                    for (int j = 0; j < 16; j++) shared_push(mine, workload[(i + j + p) % WORKLOAD_STRINGS]);
+                    for (int j = 0; j < 16; j++) free(shared_pop(mine).string);
+                }
+                close_shared(&mine);
+                _exit(0);
+            }
+        }
+        while (wait(NULL) > 0) {}
+        snprintf(label, sizeof label, "shared_stack, %d processes", processes);
+        report_time(label, now_ns() - start, SHARED_OPERATIONS);
+    }
+    close_shared(&s);
+    unlink_shared(name);
+}
+
+// Push/pop throughput of a durable stack at each durability level. Files
+// go in the current directory, so run this on the disk you care about.
+static void bench_durability(const char* label, durable_options options, int operations) {
+    char path[64];
+    snprintf(path, sizeof path, "string_stack_bench_%d", (int)getpid());
+    durable_stack s = open_durable(path, &options).stack;
+    if (s == NULL) {
+        printf("cannot open durable stack, skipping\n");
+        return;
+    }
+    double start = now_ns();
+    for (int i = 0; i < operations; i += 32) {
+        for (int j = 0; j < 16; j++) durable_push(s, workload[(i + j) % WORKLOAD_STRINGS]);
+        for (int j = 0; j < 16; j++) free(durable_pop(s).string);
+    }
+    close_durable(&s);
+    report_time(label, now_ns() - start, operations);
+
+    char file[80];
+    snprintf(file, sizeof file, "%s.journal", path);
+    unlink(file);
+    snprintf(file, sizeof file, "%s.snapshot", path);
+    unlink(file);
+}
+
+static void bench_durability_levels() {
+    bench_durability("durable, sync_never", (durable_options){sync_never, 0, 0, 65536}, 1000000);
+    bench_durability("durable, sync_batched 1024 ops / 10 ms",
+        (durable_options){sync_batched, 1024, 10000, 65536}, 200000);
+    bench_durability("durable, sync_batched 64 ops / 1 ms",
+        (durable_options){sync_batched, 64, 1000, 65536}, 50000);
+    bench_durability("durable, sync_always", (durable_options){sync_always, 1, 0, 65536}, 5000);
+}
+
+// Pushes `count` one-character elements, then pops them all. Capacity
+// doubles with realloc, which large allocators satisfy by remapping pages
+// rather than copying, so growth stays cheap at multi-GB sizes.
+static void bench_large_scale(size_t count) {
+    if (count > MAX_CAPACITY) {
+        printf("MAX_CAPACITY is %zu; rebuild with a larger -DMAX_CAPACITY\n", (size_t)MAX_CAPACITY);
+        return;
+    }
+    stack s = create().stack;
+    double start = now_ns();
+    for (size_t i = 0; i < count; i++) {
+        if (push(s, "x") != success) {
+            printf("push failed at %zu elements\n", i);
+            break;
+        }
+    }
+    report("large-scale push", now_ns() - start, (long)size(s), resident_kb());
+    size_t pushed = size(s);
+    start = now_ns();
+    while (!is_empty(s)) free(pop(s).string);
+    report_time("large-scale pop", now_ns() - start, (long)pushed);
+    destroy(&s);
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "large") == 0) {
+        bench_large_scale(argc > 2 ? strtoull(argv[2], NULL, 10) : (size_t)1 << 31);
+        return 0;
+    }
+    build_workload();
+    bench_mixed_churn();
+    bench_short_lived_stacks();
+    bench_unused_stacks();
+    bench_batches();
+    bench_length_checks();
+    bench_thread_scaling();
+    bench_shared_processes();
+    bench_durability_levels();
+    return 0;
+}
@@ -2,6 +2,13 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "string_stack.h"
 
@@ -15,6 +22,52 @@ void expect(const char* description, bool condition) {
 }
 // -----------------------------------------------------------------------------
 
+// Allocator hooks that count live bytes, to check that every allocation a
+// stack makes is routed through them and handed back.
+typedef struct {
+    long live_bytes;
+    int calls;
+} counting_context;
+
+void* counting_allocate(void* context, size_t bytes) {
+    ((counting_context*)context)->live_bytes += bytes;
+    ((counting_context*)context)->calls++;
+    return malloc(bytes);
+}
+
+void* counting_reallocate(void* context, void* pointer, size_t old_bytes, size_t new_bytes) {
+    ((counting_context*)context)->live_bytes += (long)new_bytes - (long)old_bytes;
+    ((counting_context*)context)->calls++;
+    return realloc(pointer, new_bytes);
+}
+
+void counting_deallocate(void* context, void* pointer, size_t bytes) {
+    ((counting_context*)context)->live_bytes -= bytes;
+    ((counting_context*)context)->calls++;
+    free(pointer);
+}
+
+// Each worker pushes its own strings onto a shared concurrent stack and
+// pops the same number back off, checking that nothing it gets is torn.
+#define WORKER_THREADS 8
+#define WORKER_OPERATIONS 2000
+
+void* concurrent_worker(void* shared) {
+    concurrent_stack cs = shared;
+    bool intact = true;
+    char item[32];
+    for (int i = 0; i < WORKER_OPERATIONS; i++) {
+        snprintf(item, sizeof item, "item-%d", i);
+        intact = intact && concurrent_push(cs, item) == success;
+    }
+    for (int i = 0; i < WORKER_OPERATIONS; i++) {
+        string_response r = concurrent_pop(cs);
+        intact = intact && r.code == success && strncmp(r.string, "item-", 5) == 0;
+        free(r.string);
+    }
+    return intact ? shared : NULL;
+}
+
 int main() {
 
     // Successful create (can't test out of memory though)
@@ -32,6 +85,30 @@ int main() {
     response_code code = push(s, long_string);
     expect("Guards against long elements", code == stack_element_too_large);
 
+    // Lengths are measured correctly at every alignment, right up to the limit
+    char aligned_buffer[MAX_ELEMENT_BYTE_SIZE + 64];
+    memset(aligned_buffer, 'y', sizeof aligned_buffer);
+    bool lengths_checked = true;
+    for (int offset = 0; offset < 32; offset++) {
+        for (int length = MAX_ELEMENT_BYTE_SIZE - 34; length <= MAX_ELEMENT_BYTE_SIZE; length++) {
+            aligned_buffer[offset + length] = '\0';
+            response_code expected = length < MAX_ELEMENT_BYTE_SIZE ? success : stack_element_too_large;
+            lengths_checked = lengths_checked && push(s, aligned_buffer + offset) == expected;
+            aligned_buffer[offset + length] = 'y';
+        }
+        for (int length = 0; length < 40; length++) {
+            aligned_buffer[offset + length] = '\0';
+            lengths_checked = lengths_checked && push(s, aligned_buffer + offset) == success;
+            aligned_buffer[offset + length] = 'y';
+        }
+    }
+    while (!is_empty(s)) {
+        string_response popped = pop(s);
+        lengths_checked = lengths_checked && popped.string[strspn(popped.string, "y")] == '\0';
+        free(popped.string);
+    }
+    expect("Element lengths are checked at every alignment", lengths_checked);
+
     // One element stack
     code = push(s, "first!");
     expect("Push response code is success", res.code == success);
@@ -76,10 +153,313 @@ int main() {
     r = pop(s);
     expect("Elements are defensively copied", strcmp(r.string, "hello") == 0);
 
+    // Elements of every size class round-trip, including recycled slots
+    bool round_trips = true;
+    char buffer[MAX_ELEMENT_BYTE_SIZE];
+    for (int pass = 0; pass < 2; pass++) {
+        for (int length = 0; length < MAX_ELEMENT_BYTE_SIZE; length += 15) {
+            memset(buffer, 'a' + length % 26, length);
+            buffer[length] = '\0';
+            round_trips = round_trips && push(s, buffer) == success;
+        }
+        for (int length = (MAX_ELEMENT_BYTE_SIZE - 1) / 15 * 15; length >= 0; length -= 15) {
+            r = pop(s);
+            round_trips = round_trips && r.code == success &&
+                strlen(r.string) == (size_t)length &&
+                (length == 0 || r.string[length - 1] == 'a' + length % 26);
+            free(r.string);
+        }
+    }
+    expect("Mixed-length elements round-trip", round_trips && is_empty(s));
+
+    // Strings on either side of the inline storage limit keep their contents
+    push(s, "fourteen chars");
+    push(s, "fifteen chars!!");
+    r = pop(s);
+    expect("Longest out-of-line element round-trips", strcmp(r.string, "fifteen chars!!") == 0);
+    free(r.string);
+    r = pop(s);
+    expect("Longest inline element round-trips", strcmp(r.string, "fourteen chars") == 0);
+    free(r.string);
+
     // Destroy sets to null, for memory leak testing use an external tool
     destroy(&s);
     assert(s == NULL);
   
+    // Batch pushes and pops
+    s = create().stack;
+    const char* batch[] = {"one", "two", "a third element that is stored out of line"};
+    size_t moved = 0;
+    code = push_many(s, batch, NULL, 3, &moved);
+    expect("Batch push response code is success", code == success);
+    expect("Batch push pushed every element", moved == 3 && size(s) == 3);
+    size_t prefix_lengths[] = {1, 2, 3};
+    code = push_many(s, batch, prefix_lengths, 3, &moved);
+    expect("Batch push honors explicit lengths", code == success && moved == 3);
+    const char* oversized[] = {"fine", long_string};
+    code = push_many(s, oversized, NULL, 2, &moved);
+    expect("Batch push rejects a batch with a long element",
+        code == stack_element_too_large && moved == 0 && size(s) == 6);
+    const char* late_oversized[] = {"fine", batch[2], "also fine", long_string};
+    code = push_many(s, late_oversized, NULL, 4, &moved);
+    expect("Batch push takes back what it stored before a long element",
+        code == stack_element_too_large && moved == 0 && size(s) == 6);
+    char* out[8];
+    code = pop_many(s, out, 4, &moved);
+    expect("Batch pop response code is success", code == success && moved == 4);
+    expect("Batch pop returns top first",
+        strcmp(out[0], "a t") == 0 && strcmp(out[1], "tw") == 0 &&
+        strcmp(out[2], "o") == 0 && strcmp(out[3], batch[2]) == 0);
+    for (size_t i = 0; i < moved; i++) free(out[i]);
+    code = pop_many(s, out, 8, &moved);
+    expect("Batch pop past the bottom reports stack_empty",
+        code == stack_empty && moved == 2 && is_empty(s));
+    expect("Batch pop past the bottom keeps popped elements",
+        strcmp(out[0], "two") == 0 && strcmp(out[1], "one") == 0);
+    for (size_t i = 0; i < moved; i++) free(out[i]);
+    while (size(s) < MAX_CAPACITY - 2) push(s, "hi");
+    code = push_many(s, batch, NULL, 3, &moved);
+    expect("Batch push on nearly full stack reports stack_full",
+        code == stack_full && moved == 2 && is_full(s));
+    destroy(&s);
+
+    // Custom allocators see every allocation, including popped strings
+    counting_context counts = {0, 0};
+    stack_allocator counting = {
+        counting_allocate, counting_reallocate, counting_deallocate, &counts
+    };
+    res = create_with_allocator(&counting);
+    expect("Stack with allocator creation response is success", res.code == success);
+    s = res.stack;
+    for (int i = 0; i < 100; i++) push(s, i % 2 ? "short" : "a string too long to be stored inline");
+    r = pop(s);
+    expect("Stack with allocator pops expected value", strcmp(r.string, "short") == 0);
+    counting_deallocate(&counts, r.string, strlen(r.string) + 1);
+    destroy(&s);
+    expect("Stack with allocator routes allocations through hooks", counts.calls > 0);
+    expect("Stack with allocator releases all memory", counts.live_bytes == 0);
+
+    // A stack that is never pushed to allocates only itself
+    counts = (counting_context){0, 0};
+    s = create_with_allocator(&counting).stack;
+    expect("New stack makes a single allocation", counts.calls == 1);
+    expect("Empty stack pop on an unallocated stack", pop(s).code == stack_empty);
+    destroy(&s);
+    expect("Unused stack releases all memory", counts.calls == 2 && counts.live_bytes == 0);
+
+    // Concurrent stack basics
+    concurrent_stack_response cres = create_concurrent();
+    expect("Concurrent stack creation response is success", cres.code == success);
+    concurrent_stack cs = cres.stack;
+    expect("New concurrent stack size 0", concurrent_size(cs) == 0);
+    expect("Concurrent stack guards against long elements",
+        concurrent_push(cs, long_string) == stack_element_too_large);
+    concurrent_push(cs, greeting);
+    greeting[1] = 'a';
+    r = concurrent_pop(cs);
+    expect("Concurrent stack elements are defensively copied", strcmp(r.string, "hullo") == 0);
+    free(r.string);
+    r = concurrent_pop(cs);
+    expect("Pop from empty concurrent stack code is stack_empty", r.code == stack_empty);
+
+    // Concurrent stack shared by several threads
+    pthread_t workers[WORKER_THREADS];
+    for (int i = 0; i < WORKER_THREADS; i++) {
+        pthread_create(&workers[i], NULL, concurrent_worker, cs);
+    }
+    bool all_intact = true;
+    for (int i = 0; i < WORKER_THREADS; i++) {
+        void* result;
+        pthread_join(workers[i], &result);
+        all_intact = all_intact && result != NULL;
+    }
+    expect("Concurrent pushes and pops from many threads succeed", all_intact);
+    expect("Concurrent stack empty after balanced pushes and pops", concurrent_size(cs) == 0);
+    destroy_concurrent(&cs);
+    expect("Destroy concurrent stack sets it to null", cs == NULL);
+
+    // Shared stack visible from another process
+    char shared_name[64];
+    snprintf(shared_name, sizeof shared_name, "/string_stack_test_%d", (int)getpid());
+    shared_stack_response sres = create_shared(shared_name, 64);
+    expect("Shared stack creation response is success", sres.code == success);
+    shared_stack ss = sres.stack;
+    expect("Creating an existing shared stack is an error",
+        create_shared(shared_name, 64).code == stack_unavailable);
+    expect("Shared stack guards against long elements",
+        shared_push(ss, long_string) == stack_element_too_large);
+    shared_push(ss, "from parent");
+    pid_t child = fork();
+    if (child == 0) {
+        shared_stack_response opened = open_shared(shared_name);
+        bool ok = opened.code == success;
+        if (ok) {
+            string_response from_parent = shared_pop(opened.stack);
+            ok = strcmp(from_parent.string, "from parent") == 0;
+            free(from_parent.string);
+            shared_push(opened.stack, "from the child, long enough to live in the arena");
+            shared_push(opened.stack, "from child");
+            close_shared(&opened.stack);
+        }
+        _exit(ok ? 0 : 1);
+    }
+    int status;
+    waitpid(child, &status, 0);
+    expect("Child process pops and pushes on shared stack",
+        WIFEXITED(status) && WEXITSTATUS(status) == 0 && shared_size(ss) == 2);
+    r = shared_pop(ss);
+    expect("Shared stack pops inline element pushed by child", strcmp(r.string, "from child") == 0);
+    free(r.string);
+    r = shared_pop(ss);
+    expect("Shared stack pops arena element pushed by child",
+        strcmp(r.string, "from the child, long enough to live in the arena") == 0);
+    free(r.string);
+    r = shared_pop(ss);
+    expect("Pop from empty shared stack code is stack_empty", r.code == stack_empty);
+    while (shared_push(ss, "a string that is stored in the shared arena") == success) {}
+    expect("Shared stack fills to its capacity", shared_size(ss) == 64);
+    close_shared(&ss);
+    unlink_shared(shared_name);
+    expect("Unlinked shared stack cannot be opened", open_shared(shared_name).code == stack_unavailable);
+
+    // Shared stack outlives a process killed while using it
+    sres = create_shared(shared_name, 64);
+    ss = sres.stack;
+    bool usable = sres.code == success;
+    for (int round = 0; usable && round < 20; round++) {
+        child = fork();
+        if (child == 0) {
+            for (;;) {
+                shared_push(ss, "pushed until killed");
+                string_response popped = shared_pop(ss);
+                free(popped.string);
+            }
+        }
+        nanosleep(&(struct timespec){0, 2000000}, NULL);
+        kill(child, SIGKILL);
+        waitpid(child, &status, 0);
+        alarm(10);  // A lock left held would hang here
+        usable = shared_push(ss, "after the kill") == success;
+        r = shared_pop(ss);
+        usable = usable && r.code == success;
+        free(r.string);
+        alarm(0);
+    }
+    expect("Shared stack stays usable after a process dies holding its lock", usable);
+    close_shared(&ss);
+    unlink_shared(shared_name);
+
+    // Durable stack contents survive closing and reopening
+    char durable_path[64];
+    snprintf(durable_path, sizeof durable_path, "/tmp/string_stack_test_%d", (int)getpid());
+    durable_options always = {sync_always, 1, 0, 0};
+    durable_stack_response dres = open_durable(durable_path, &always);
+    expect("Durable stack open response is success", dres.code == success);
+    durable_stack ds = dres.stack;
+    expect("New durable stack size 0", durable_size(ds) == 0);
+    expect("Durable stack guards against long elements",
+        durable_push(ds, long_string) == stack_element_too_large);
+    durable_push(ds, "kept");
+    durable_push(ds, "a longer element that is kept out of line");
+    durable_push(ds, "popped");
+    r = durable_pop(ds);
+    expect("Durable stack pops expected value", strcmp(r.string, "popped") == 0);
+    free(r.string);
+    close_durable(&ds);
+    ds = open_durable(durable_path, &always).stack;
+    expect("Reopened durable stack has committed elements", durable_size(ds) == 2);
+    r = durable_pop(ds);
+    expect("Reopened durable stack pops expected value",
+        strcmp(r.string, "a longer element that is kept out of line") == 0);
+    free(r.string);
+    close_durable(&ds);
+
+    // A crash keeps every committed operation and a torn record is dropped
+    child = fork();
+    if (child == 0) {
+        durable_stack crashing = open_durable(durable_path, &always).stack;
+        durable_push(crashing, "committed before crash");
+        _exit(0);
+    }
+    waitpid(child, &status, 0);
+    char journal_path[80];
+    snprintf(journal_path, sizeof journal_path, "%s.journal", durable_path);
+    FILE* journal = fopen(journal_path, "ab");
+    fputs("+\x09torn", journal);
+    fclose(journal);
+    ds = open_durable(durable_path, &always).stack;
+    expect("Durable stack recovers after crash", ds != NULL && durable_size(ds) == 2);
+    r = durable_pop(ds);
+    expect("Durable stack keeps operation committed before crash",
+        strcmp(r.string, "committed before crash") == 0);
+    free(r.string);
+    close_durable(&ds);
+
+    // Snapshots compact the journal without losing elements
+    durable_options compacting = {sync_batched, 8, 1000000, 10};
+    ds = open_durable(durable_path, &compacting).stack;
+    for (int i = 0; i < 25; i++) durable_push(ds, i % 2 ? "odd" : "even");
+    durable_snapshot(ds);
+    durable_push(ds, "after snapshot");
+    close_durable(&ds);
+    ds = open_durable(durable_path, NULL).stack;
+    expect("Durable stack recovers from snapshot and journal", durable_size(ds) == 27);
+    r = durable_pop(ds);
+    expect("Durable stack replays journal after snapshot", strcmp(r.string, "after snapshot") == 0);
+    free(r.string);
+    r = durable_pop(ds);
+    expect("Durable stack restores snapshot elements", strcmp(r.string, "even") == 0);
+    free(r.string);
+    close_durable(&ds);
+
+    // A snapshot that cannot be written does not fail the operation it follows
+    char blocked_path[80];
+    snprintf(blocked_path, sizeof blocked_path, "%s.snapshot.tmp", durable_path);
+    mkdir(blocked_path, 0700);
+    durable_options snapshot_every_two = {sync_always, 1, 0, 2};
+    ds = open_durable(durable_path, &snapshot_every_two).stack;
+    size_t before = durable_size(ds);
+    bool pushed_both = durable_push(ds, "first") == success && durable_push(ds, "second") == success;
+    expect("Failed snapshot still reports the push", pushed_both && durable_size(ds) == before + 2);
+    close_durable(&ds);
+    rmdir(blocked_path);
+    ds = open_durable(durable_path, NULL).stack;
+    expect("Operations before a failed snapshot are recovered", durable_size(ds) == before + 2);
+    close_durable(&ds);
+
+    // A journal that fails beyond repair keeps the operation and reports it
+    int journal_fd = open("/dev/null", O_RDONLY);  // The next free descriptor
+    close(journal_fd);
+    ds = open_durable(durable_path, &always).stack;
+    before = durable_size(ds);
+    int full = open("/dev/full", O_WRONLY);  // Writes fail and it cannot be truncated
+    dup2(full, journal_fd);
+    expect("Push into a broken journal reports failure", durable_push(ds, "kept anyway") == stack_unavailable);
+    r = durable_pop(ds);
+    expect("Pop from a broken journal reports failure but hands over the string",
+        r.code == stack_unavailable && strcmp(r.string, "kept anyway") == 0);
+    free(r.string);
+    durable_push(ds, "kept anyway");
+    expect("Operations on a broken journal stay applied", durable_size(ds) == before + 1);
+    snprintf(journal_path, sizeof journal_path, "%s.journal", durable_path);
+    int repaired = open(journal_path, O_WRONLY | O_APPEND);
+    dup2(repaired, journal_fd);
+    close(repaired);
+    close(full);
+    expect("Push after the journal is repaired succeeds", durable_push(ds, "after repair") == success);
+    close_durable(&ds);
+    ds = open_durable(durable_path, NULL).stack;
+    expect("Operations on a broken journal are recovered", durable_size(ds) == before + 2);
+    r = durable_pop(ds);
+    expect("Journal written after the repair is replayed", strcmp(r.string, "after repair") == 0);
+    free(r.string);
+    close_durable(&ds);
+
+    snprintf(journal_path, sizeof journal_path, "%s.journal", durable_path);
+    unlink(journal_path);
+    snprintf(journal_path, sizeof journal_path, "%s.snapshot", durable_path);
+    unlink(journal_path);
+
     printf("\n%d passed, %d failed\n", passed, failed);
     return 0;
 }
@@ -0,0 +1,94 @@
+#include <iostream>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+using namespace std;
+
+#include "aggregate_stack.h"
+
+// -----------------------------------------------------------------------------
+int passed = 0;
+int failed = 0;
+
+void expect(string description, bool condition) {
+  if (condition) passed++; else failed++;
+  cout << description << " " << (condition ? "PASS" : "FAIL") << endl;
+}
+// -----------------------------------------------------------------------------
+
+int main() {
+
+    AggregateStack<int, MinMonoid<int>> mins;
+    expect("New aggregate stack empty", mins.is_empty() && mins.size() == 0);
+    expect("Empty aggregate is the identity", mins.aggregate() == numeric_limits<int>::max());
+
+    // The aggregate follows pushes and is restored by pops
+    mins.push(5);
+    mins.push(3);
+    mins.push(7);
+    mins.push(1);
+    expect("Min after pushes", mins.aggregate() == 1 && mins.size() == 4);
+    expect("Pop returns the top item", mins.pop() == 1);
+    expect("Min restored after popping the minimum", mins.aggregate() == 3);
+    mins.pop();
+    mins.pop();
+    expect("Min of the bottom item alone", mins.aggregate() == 5);
+
+    AggregateStack<double, MaxMonoid<double>> maxes;
+    maxes.push(-2.5);
+    maxes.push(-7.0);
+    expect("Max of negative values", maxes.aggregate() == -2.5);
+
+    AggregateStack<long, SumMonoid<long>> sums;
+    for (long i = 1; i <= 1000; i++) sums.push(i);
+    expect("Sum after many pushes", sums.aggregate() == 500500);
+    for (int i = 0; i < 500; i++) sums.pop();
+    expect("Sum after popping half", sums.aggregate() == 125250);
+
+    AggregateStack<int, GcdMonoid<int>> gcds;
+    gcds.push(84);
+    gcds.push(36);
+    expect("Gcd of two items", gcds.aggregate() == 12);
+    gcds.push(10);
+    expect("Gcd falls with a third item", gcds.aggregate() == 2);
+    gcds.pop();
+    expect("Gcd restored after pop", gcds.aggregate() == 12);
+
+    // Non-trivial elements with a custom monoid
+    struct Concat {
+        static string identity() { return ""; }
+        static string combine(const string& a, const string& b) { return a + b; }
+    };
+    AggregateStack<string, Concat> words;
+    words.push("stack");
+    words.push("ed");
+    expect("Custom monoid combines bottom to top", words.aggregate() == "stacked");
+    expect("Pop returns non-trivial items", words.pop() == "ed" && words.aggregate() == "stack");
+
+    // Errors come from the underlying stack
+    bool thrown = false;
+    try {
+        mins.pop();
+        mins.pop();
+    } catch (underflow_error& e) {
+        thrown = true;
+    }
+    expect("Pop from empty aggregate stack should throw", thrown);
+    expect("Aggregate of emptied stack is the identity", mins.aggregate() == numeric_limits<int>::max());
+
+    // A push onto a full stack is rejected without touching the aggregate
+    AggregateStack<string, Concat> full;
+    full.push("kept");
+    while (full.size() < size_t(MAX_CAPACITY)) full.push("");
+    thrown = false;
+    try {
+        full.push("rejected");
+    } catch (overflow_error& e) {
+        thrown = true;
+    }
+    expect("Push onto a full aggregate stack should throw", thrown);
+    expect("Rejected push leaves the aggregate unchanged", full.aggregate() == "kept");
+
+    printf("\n%d passed, %d failed\n", passed, failed);
+    return 0;
+}
@@ -0,0 +1,217 @@
+/**
+ * @class CompressedStack
+ * @brief A stack of integers stored as variable-length deltas.
+ *
+ * Values are compressed in blocks of `COMPRESSED_BLOCK`. Each block keeps its first value
+ * whole, as an anchor, followed by the difference between each value and the one before it,
+ * zigzag-encoded so that small negative differences stay small, in LEB128 varints of seven
+ * bits per byte. Offsets that mostly grow by small steps therefore take one or two bytes each
+ * instead of eight.
+ *
+ * The top of the stack is kept uncompressed, in a buffer of two blocks' worth of values. A
+ * push that finds it full compresses its lower half into a block; a pop that finds it empty
+ * decodes the last block back into it. Each block is then followed by at least a block's
+ * worth of cheap operations before the next one is touched, so push and pop are O(1)
+ * amortized, even when they alternate at a block boundary.
+ *
+ * @tparam Int The integer type to store, signed or unsigned.
+ *
+ * ## Key Features:
+ * - **Compact Storage**: Deltas use as many bytes as their magnitude needs, and any block can
+ *   be decoded on its own from its anchor.
+ * - **Vectorized Drain**: `drain(values)` decodes every block in one pass. With SSE2, runs of sixteen
+ *   one-byte deltas are decoded and summed sixteen at a time.
+ * - **Exception Safety**: Popping an empty stack throws `std::underflow_error`.
+ *
+ * ## Public Methods:
+ * - `CompressedStack()`: Constructs an empty stack.
+ * - `size_t size() const`: Returns the current number of elements in the stack.
+ * - `bool is_empty() const`: Checks if the stack is empty.
+ * - `void push(Int item)`: Adds an item to the top of the stack.
+ * - `Int pop()`: Removes and returns the item at the top of the stack.
+ * - `void drain(vector<Int>& values)`: Removes every item, appending them to `values` bottom
+ *   to top. Reusing one vector across drains saves faulting in fresh pages each time.
+ * - `size_t compressed_bytes() const`: Returns the bytes used by anchors, deltas and the
+ *   uncompressed top, excluding spare capacity.
+*/
+
+#ifndef COMPRESSED_STACK_H
+#define COMPRESSED_STACK_H
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+using namespace std;
+
+
+#define COMPRESSED_BLOCK 128
+
+template <typename Int>
+class CompressedStack {
+  static_assert(is_integral_v<Int> && !is_same_v<Int, bool>, "CompressedStack stores integers");
+
+  using Unsigned = make_unsigned_t<Int>;
+  using Signed = make_signed_t<Int>;
+  static constexpr size_t max_varint_bytes = (sizeof(Int) * 8 + 6) / 7;
+
+  struct Block {
+    size_t end;
+    Int anchor;
+  };
+
+  vector<uint8_t> bytes;
+  vector<Block> blocks;
+  Int top_values[2 * COMPRESSED_BLOCK];
+  size_t top_size;
+
+public:
+  CompressedStack(): top_size(0) {
+  }
+
+  size_t size() const {
+    return blocks.size() * COMPRESSED_BLOCK + top_size;
+  }
+
+  bool is_empty() const {
+    return size() == 0;
+  }
+
+  void push(Int item) {
+    if (top_size == 2 * COMPRESSED_BLOCK) {
+      compress(top_values);
+      memmove(top_values, top_values + COMPRESSED_BLOCK, COMPRESSED_BLOCK * sizeof(Int));
+      top_size = COMPRESSED_BLOCK;
+    }
+    top_values[top_size++] = item;
+  }
+
+  Int pop() {
+    if (top_size == 0) {
+      if (blocks.empty()) {
+        throw underflow_error("cannot pop from empty stack");
+      }
+      decompress_last(top_values);
+      top_size = COMPRESSED_BLOCK;
+    }
+    return top_values[--top_size];
+  }
+
+  void drain(vector<Int>& values) {
+    size_t first = values.size();
+    values.resize(first + size());
+    Int* out = values.data() + first;
+    const uint8_t* cursor = bytes.data();
+    const uint8_t* end = bytes.data() + bytes.size();
+    for (size_t i = 0; i < blocks.size(); i++) {
+      cursor = decode(cursor, end, blocks[i].anchor, out + i * COMPRESSED_BLOCK);
+    }
+    copy(top_values, top_values + top_size, out + blocks.size() * COMPRESSED_BLOCK);
+    bytes.clear();
+    blocks.clear();
+    top_size = 0;
+  }
+
+  size_t compressed_bytes() const {
+    return bytes.size() + blocks.size() * sizeof(Block) + top_size * sizeof(Int);
+  }
+
+private:
+  void compress(const Int* values) {
+    size_t start = bytes.size();
+    bytes.resize(start + (COMPRESSED_BLOCK - 1) * max_varint_bytes);
+    uint8_t* cursor = bytes.data() + start;
+    for (size_t i = 1; i < COMPRESSED_BLOCK; i++) {
+      Unsigned delta = Unsigned(values[i]) - Unsigned(values[i - 1]);
+      Unsigned zigzag = Unsigned(delta << 1) ^ Unsigned(Signed(delta) >> (sizeof(Int) * 8 - 1));
+      while (zigzag >= 0x80) {
+        *cursor++ = uint8_t(zigzag) | 0x80;
+        zigzag >>= 7;
+      }
+      *cursor++ = uint8_t(zigzag);
+    }
+    bytes.resize(cursor - bytes.data());
+    blocks.push_back(Block{bytes.size(), values[0]});
+  }
+
+  void decompress_last(Int* values) {
+    size_t start = blocks.size() > 1 ? blocks[blocks.size() - 2].end : 0;
+    decode(bytes.data() + start, bytes.data() + bytes.size(), blocks.back().anchor, values);
+    bytes.resize(start);
+    blocks.pop_back();
+  }
+
+  static Unsigned unzigzag(Unsigned zigzag) {
+    return (zigzag >> 1) ^ (Unsigned(0) - (zigzag & 1));
+  }
+
+  // Decodes one block into `values`, returning the start of the next block.
+  // `end` bounds the whole byte stream, so that the vector path can tell
+  // when sixteen bytes may be loaded without reading past it.
+  static const uint8_t* decode(const uint8_t* cursor, const uint8_t* end, Int anchor, Int* values) {
+    Unsigned previous = Unsigned(anchor);
+    values[0] = anchor;
+    size_t i = 1;
+    while (i < COMPRESSED_BLOCK) {
+#ifdef __SSE2__
+      if (COMPRESSED_BLOCK - i >= 16 && end - cursor >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cursor));
+        if (_mm_movemask_epi8(chunk) == 0) {
+          decode_sixteen(chunk, previous, values + i);
+          previous = Unsigned(values[i + 15]);
+          cursor += 16;
+          i += 16;
+          continue;
+        }
+      }
+#endif
+      Unsigned zigzag = 0;
+      unsigned shift = 0;
+      uint8_t byte;
+      do {
+        byte = *cursor++;
+        zigzag |= Unsigned(byte & 0x7F) << shift;
+        shift += 7;
+      } while (byte & 0x80);
+      previous += unzigzag(zigzag);
+      values[i++] = Int(previous);
+    }
+    return cursor;
+  }
+
+#ifdef __SSE2__
+  // Sixteen one-byte zigzag deltas: undo the zigzag bytewise, widen to 16-bit
+  // lanes and take prefix sums within each half, which cannot overflow since
+  // eight deltas of at most 64 sum to at most 512.
+  static void decode_sixteen(__m128i chunk, Unsigned previous, Int* values) {
+    __m128i half = _mm_and_si128(_mm_srli_epi16(chunk, 1), _mm_set1_epi8(0x7F));
+    __m128i sign = _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(chunk, _mm_set1_epi8(1)));
+    __m128i deltas = _mm_xor_si128(half, sign);
+    __m128i negative = _mm_cmpgt_epi8(_mm_setzero_si128(), deltas);
+    __m128i low = _mm_unpacklo_epi8(deltas, negative);
+    __m128i high = _mm_unpackhi_epi8(deltas, negative);
+    low = _mm_add_epi16(low, _mm_slli_si128(low, 2));
+    high = _mm_add_epi16(high, _mm_slli_si128(high, 2));
+    low = _mm_add_epi16(low, _mm_slli_si128(low, 4));
+    high = _mm_add_epi16(high, _mm_slli_si128(high, 4));
+    low = _mm_add_epi16(low, _mm_slli_si128(low, 8));
+    high = _mm_add_epi16(high, _mm_slli_si128(high, 8));
+    int16_t sums[16];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(sums), low);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(sums + 8), high);
+    for (size_t j = 0; j < 8; j++) {
+      values[j] = Int(previous + Unsigned(Signed(sums[j])));
+    }
+    previous += Unsigned(Signed(sums[7]));
+    for (size_t j = 0; j < 8; j++) {
+      values[8 + j] = Int(previous + Unsigned(Signed(sums[8 + j])));
+    }
+  }
+#endif
+};
+
+#endif
@@ -0,0 +1,106 @@
+#include <iostream>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "compressed_stack.h"
+
+// -----------------------------------------------------------------------------
+int passed = 0;
+int failed = 0;
+
+void expect(string description, bool condition) {
+  if (condition) passed++; else failed++;
+  cout << description << " " << (condition ? "PASS" : "FAIL") << endl;
+}
+// -----------------------------------------------------------------------------
+
+// Pushes every value, pops them all back, and checks they come out reversed.
+template <typename Int>
+bool round_trips(const vector<Int>& values) {
+  CompressedStack<Int> stack;
+  for (Int value : values) stack.push(value);
+  if (stack.size() != values.size()) return false;
+  for (size_t i = values.size(); i > 0; i--) {
+    if (stack.pop() != values[i - 1]) return false;
+  }
+  return stack.is_empty();
+}
+
+int main() {
+
+    CompressedStack<int64_t> offsets;
+    expect("New compressed stack empty", offsets.is_empty() && offsets.size() == 0);
+
+    // Monotone offsets compress to a byte or so each
+    vector<int64_t> monotone;
+    int64_t offset = 1000000000000;
+    for (int i = 0; i < 100000; i++) monotone.push_back(offset += (i * 7919) % 100);
+    for (int64_t value : monotone) offsets.push(value);
+    expect("Size counts compressed and uncompressed items", offsets.size() == 100000);
+    expect("Monotone offsets shrink at least fourfold",
+        offsets.compressed_bytes() * 4 < monotone.size() * sizeof(int64_t));
+    expect("Monotone offsets round trip", round_trips(monotone));
+
+    // Extremes, sign changes and wraparound all survive the deltas
+    vector<int64_t> extremes;
+    for (int i = 0; i < 1000; i++) {
+        extremes.push_back(i % 3 == 0 ? numeric_limits<int64_t>::min()
+            : i % 3 == 1 ? numeric_limits<int64_t>::max() : -i);
+    }
+    expect("Extreme signed values round trip", round_trips(extremes));
+    vector<uint32_t> wrapping;
+    for (uint32_t i = 0; i < 1000; i++) wrapping.push_back(i * 2654435761u);
+    expect("Wrapping unsigned values round trip", round_trips(wrapping));
+    vector<int8_t> small;
+    for (int i = 0; i < 1000; i++) small.push_back(int8_t(i * 37));
+    expect("Eight-bit values round trip", round_trips(small));
+
+    // Alternating at a block boundary keeps working
+    CompressedStack<int> boundary;
+    for (int i = 0; i < 2 * COMPRESSED_BLOCK; i++) boundary.push(i);
+    bool alternating = true;
+    for (int i = 0; i < 1000; i++) {
+        boundary.push(-i);
+        alternating = alternating && boundary.pop() == -i;
+        int below = boundary.pop();
+        alternating = alternating && below == 2 * COMPRESSED_BLOCK - 1;
+        boundary.push(below);
+    }
+    expect("Push and pop alternating at a block boundary", alternating);
+
+    // Draining decodes everything in push order, including mixed delta widths
+    CompressedStack<int64_t> mixed;
+    vector<int64_t> expected;
+    int64_t value = 0;
+    for (int i = 0; i < 5000; i++) {
+        value += i % 50 == 0 ? int64_t(1) << (i % 40) : (i % 7) - 3;
+        mixed.push(value);
+        expected.push_back(value);
+    }
+    vector<int64_t> drained = {-1};
+    mixed.drain(drained);
+    expected.insert(expected.begin(), -1);
+    expect("Drain appends every item bottom to top", drained == expected);
+    expect("Drained stack is empty", mixed.is_empty() && mixed.compressed_bytes() == 0);
+    mixed.push(5);
+    expect("Drained stack is usable", mixed.pop() == 5);
+
+    // Pop from empty stack is an error
+    bool thrown = false;
+    try {
+        mixed.pop();
+    } catch (underflow_error& e) {
+        thrown = true;
+        expect("Underflow exception message is correct",
+             string("cannot pop from empty stack") == e.what());
+    }
+    expect("Pop from empty stack should throw", thrown);
+
+    printf("\n%d passed, %d failed\n", passed, failed);
+    return 0;
+}
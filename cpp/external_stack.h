@@ -0,0 +1,219 @@
+/**
+ * @class ExternalStack
+ * @brief A stack that can grow larger than memory by spilling its bottom to disk.
+ *
+ * Elements are kept in fixed-size blocks. Only the top blocks, up to a configurable memory
+ * budget, stay in memory; when the budget is exhausted, the coldest block (the bottom-most one
+ * still in memory) is written to an anonymous temporary file in one large sequential write.
+ * Since a stack only ever touches its top, spilled blocks always form a contiguous prefix of
+ * the file, and they come back in reverse order as the stack is popped.
+ *
+ * @tparam T The type of elements to store in the stack. Elements are written to disk bytewise,
+ *           so T must be trivially copyable.
+ *
+ * ## Key Features:
+ * - **Bounded Memory**: At most `memory_budget / block bytes` blocks are resident, including the
+ *   one reserved for prefetching, no matter how deep the stack grows.
+ * - **Asynchronous Prefetch**: Once pops bring the in-memory part of the stack down to a single
+ *   block, the next spilled block is read back on a background thread, so that it is usually
+ *   ready by the time the stack needs it.
+ * - **Exception Safety**: Popping an empty stack throws `std::underflow_error`; failing to
+ *   write or read the spill file throws `std::runtime_error`.
+ *
+ * ## Constraints:
+ * - Copying and moving are deleted, since the stack owns a file and a background read.
+ *
+ * ## Public Methods:
+ * - `ExternalStack(size_t block_size, size_t memory_budget)`: Constructs an empty stack with
+ *   `block_size` elements per block and at most `memory_budget` bytes of resident blocks.
+ * - `size_t size() const`: Returns the current number of elements in the stack.
+ * - `bool is_empty() const`: Checks if the stack is empty.
+ * - `size_t spilled_blocks() const`: Returns how many blocks currently live on disk.
+ * - `void push(T item)`: Adds an item to the top of the stack.
+ * - `T pop()`: Removes and returns the item at the top of the stack.
+*/
+
+#ifndef EXTERNAL_STACK_H
+#define EXTERNAL_STACK_H
+
+#include <cstdio>
+#include <deque>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <unistd.h>
+using namespace std;
+
+
+#define DEFAULT_BLOCK_SIZE 65536
+#define DEFAULT_MEMORY_BUDGET (64 << 20)
+
+template <typename T>
+class ExternalStack {
+  static_assert(is_trivially_copyable_v<T>, "ExternalStack spills elements bytewise");
+
+  using Block = unique_ptr<T[]>;
+
+  size_t block_size;
+  size_t max_resident_blocks;
+  deque<Block> resident;
+  size_t top_fill;
+  size_t spilled;
+  unique_ptr<FILE, int (*)(FILE*)> spill_file;
+
+  future<Block> prefetch;
+  size_t prefetch_index;
+  Block spare;
+
+  ExternalStack(const ExternalStack<T>&) = delete;
+  ExternalStack<T>& operator=(const ExternalStack<T>&) = delete;
+
+public:
+  ExternalStack(size_t block_size = DEFAULT_BLOCK_SIZE, size_t memory_budget = DEFAULT_MEMORY_BUDGET):
+    block_size(max(block_size, size_t(1))),
+    // One block of the budget is held back for the prefetch buffer
+    max_resident_blocks(max(memory_budget / (this->block_size * sizeof(T)), size_t(3)) - 1),
+    top_fill(0),
+    spilled(0),
+    spill_file(nullptr, fclose),
+    prefetch_index(0) {
+  }
+
+  ~ExternalStack() {
+    // The background read must finish before its file is closed
+    if (prefetch.valid()) {
+      prefetch.wait();
+    }
+  }
+
+  size_t size() const {
+    if (resident.empty()) {
+      return spilled * block_size;
+    }
+    return (spilled + resident.size() - 1) * block_size + top_fill;
+  }
+
+  bool is_empty() const {
+    return size() == 0;
+  }
+
+  size_t spilled_blocks() const {
+    return spilled;
+  }
+
+  void push(T item) {
+    if (resident.empty() || top_fill == block_size) {
+      if (resident.size() == max_resident_blocks) {
+        spill_bottom();
+      }
+      resident.push_back(new_block());
+      top_fill = 0;
+    }
+    resident.back()[top_fill++] = item;
+  }
+
+  T pop() {
+    if (is_empty()) {
+      throw underflow_error("cannot pop from empty stack");
+    }
+    if (resident.empty()) {
+      // The block stays counted as spilled until it is resident, so a
+      // failed read or push_back leaves it on disk for the next pop
+      resident.push_back(reload());
+      spilled--;
+      top_fill = block_size;
+    }
+    T popped_value = resident.back()[--top_fill];
+    if (top_fill == 0) {
+      spare = move(resident.back());
+      resident.pop_back();
+      if (!resident.empty()) {
+        top_fill = block_size;
+      }
+    }
+    if (resident.size() <= 1 && spilled > 0 && !prefetch.valid()) {
+      start_prefetch();
+    }
+    return popped_value;
+  }
+
+private:
+  size_t block_bytes() const {
+    return block_size * sizeof(T);
+  }
+
+  Block new_block() {
+    if (spare) {
+      return move(spare);
+    }
+    return Block(new T[block_size]);
+  }
+
+  int spill_fd() {
+    if (!spill_file) {
+      spill_file.reset(tmpfile());
+      if (!spill_file) {
+        throw runtime_error("cannot create spill file");
+      }
+    }
+    return fileno(spill_file.get());
+  }
+
+  void spill_bottom() {
+    const char* bytes = reinterpret_cast<const char*>(resident.front().get());
+    off_t offset = static_cast<off_t>(spilled * block_bytes());
+    size_t written = 0;
+    while (written < block_bytes()) {
+      ssize_t result = pwrite(spill_fd(), bytes + written, block_bytes() - written, offset + written);
+      if (result <= 0) {
+        throw runtime_error("cannot write spill file");
+      }
+      written += static_cast<size_t>(result);
+    }
+    spare = move(resident.front());
+    resident.pop_front();
+    spilled++;
+  }
+
+  static Block read_block(int fd, size_t index, size_t bytes, Block block) {
+    char* destination = reinterpret_cast<char*>(block.get());
+    off_t offset = static_cast<off_t>(index * bytes);
+    size_t got = 0;
+    while (got < bytes) {
+      ssize_t result = pread(fd, destination + got, bytes - got, offset + got);
+      if (result <= 0) {
+        throw runtime_error("cannot read spill file");
+      }
+      got += static_cast<size_t>(result);
+    }
+    return block;
+  }
+
+  // Prefetching is only an optimization, so a read that cannot be started
+  // does not fail the pop that asked for it; reload() reads the block itself.
+  void start_prefetch() {
+    try {
+      prefetch_index = spilled - 1;
+      prefetch = async(launch::async, read_block, spill_fd(), prefetch_index, block_bytes(),
+        new_block());
+    } catch (...) {
+    }
+  }
+
+  // Reads back the top spilled block, from the prefetch when it has the
+  // right one and with a blocking read otherwise. Leaves `spilled` alone.
+  Block reload() {
+    size_t index = spilled - 1;
+    if (prefetch.valid()) {
+      Block block = prefetch.get();
+      if (prefetch_index == index) {
+        return block;
+      }
+      spare = move(block);
+    }
+    return read_block(spill_fd(), index, block_bytes(), new_block());
+  }
+};
+
+#endif
@@ -0,0 +1,109 @@
+#include <iostream>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+using namespace std;
+
+#include "external_stack.h"
+
+// -----------------------------------------------------------------------------
+int passed = 0;
+int failed = 0;
+
+void expect(string description, bool condition) {
+  if (condition) passed++; else failed++;
+  cout << description << " " << (condition ? "PASS" : "FAIL") << endl;
+}
+// -----------------------------------------------------------------------------
+
+struct Edge {
+  int vertex;
+  double weight;
+};
+
+int main() {
+
+    // Tiny blocks and budget, so a few thousand elements spill to disk
+    ExternalStack<long> es(64, 64 * sizeof(long) * 4);
+    expect("New external stack empty", es.is_empty());
+    expect("New external stack size 0", es.size() == 0);
+
+    for (long i = 0; i < 10000; i++) es.push(i);
+    expect("External stack size after pushes", es.size() == 10000);
+    expect("External stack spills beyond its budget", es.spilled_blocks() > 100);
+    expect("External stack keeps at most its budget in memory",
+        es.size() - es.spilled_blocks() * 64 <= 3 * 64);
+
+    // Pop partway into the spilled blocks, then push again over them
+    bool in_order = true;
+    for (long i = 9999; i >= 5000; i--) in_order = in_order && es.pop() == i;
+    expect("External stack pops spilled elements in order", in_order);
+    for (long i = 5000; i < 7000; i++) es.push(-i);
+    for (long i = 6999; i >= 5000; i--) in_order = in_order && es.pop() == -i;
+    for (long i = 4999; i >= 0; i--) in_order = in_order && es.pop() == i;
+    expect("External stack survives pushes over prefetched blocks", in_order);
+    expect("After popping everything, empty", es.is_empty() && es.spilled_blocks() == 0);
+
+    // Pop when empty is an error
+    bool thrown = false;
+    try {
+        es.pop();
+    } catch (underflow_error& e) {
+        thrown = true;
+        expect("Underflow exception message is correct",
+             string("cannot pop from empty stack") == e.what());
+    }
+    expect("Pop from empty stack should throw", thrown);
+
+    // Elements of a struct type round-trip through the spill file
+    ExternalStack<Edge> edges(16, 16 * sizeof(Edge) * 3);
+    for (int i = 0; i < 1000; i++) edges.push(Edge{i, i / 2.0});
+    bool edges_intact = true;
+    for (int i = 999; i >= 0; i--) {
+        Edge e = edges.pop();
+        edges_intact = edges_intact && e.vertex == i && e.weight == i / 2.0;
+    }
+    expect("Struct elements round-trip through disk", edges_intact);
+
+    // A spilled block that cannot be read back stays on disk for the next pop
+    int spill_descriptor = open("/dev/null", O_RDONLY);  // tmpfile() gets the next free one
+    close(spill_descriptor);
+    ExternalStack<long> unreadable(4, 4 * sizeof(long) * 4);
+    for (long i = 0; i < 40; i++) unreadable.push(i);
+    int saved = dup(spill_descriptor);
+    int write_only = open("/dev/null", O_WRONLY);
+    dup2(write_only, spill_descriptor);
+    long next = 39;
+    bool read_failed = false;
+    bool kept = false;
+    in_order = true;
+    while (!read_failed && !unreadable.is_empty()) {
+        size_t size_before = unreadable.size();
+        size_t spilled_before = unreadable.spilled_blocks();
+        try {
+            long popped = unreadable.pop();
+            in_order = in_order && popped == next--;
+        } catch (runtime_error& e) {
+            read_failed = true;
+            kept = unreadable.size() == size_before && unreadable.spilled_blocks() == spilled_before;
+        }
+    }
+    expect("Failed read of a spilled block throws", read_failed);
+    expect("Failed read of a spilled block loses no elements", kept);
+    dup2(saved, spill_descriptor);
+    close(saved);
+    close(write_only);
+    for (; next >= 0; next--) {
+        long popped = unreadable.pop();
+        in_order = in_order && popped == next;
+    }
+    expect("Spilled block is read once the file is readable again", in_order && unreadable.is_empty());
+
+    // Next line should be compiler error if uncommented
+    // ExternalStack<string> strings;
+
+    printf("\n%d passed, %d failed\n", passed, failed);
+    return 0;
+}
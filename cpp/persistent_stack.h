@@ -0,0 +1,220 @@
+/**
+ * @class PersistentStack
+ * @brief An immutable stack whose versions share structure, so forking one is O(1).
+ *
+ * Every push or pop returns a new version of the stack and leaves the original untouched. A
+ * version is just a pointer to its top node; pushing allocates one node that points at the
+ * old top, and popping returns the version below. Versions therefore share all the nodes
+ * beneath their tops, and copying a version (to fork a search, or to keep an undo history)
+ * only bumps a reference count.
+ *
+ * @tparam T The type of elements to store in the stack.
+ *
+ * ## Key Features:
+ * - **O(1) Fork**: Copying and assigning versions are constant time, whatever their depth.
+ * - **Pooled Nodes**: Nodes come from a pool that carves them out of large chunks and recycles
+ *   released nodes through per-thread free lists, so pushes rarely reach the system allocator
+ *   or take a lock.
+ * - **Reference Counting**: A node is released as soon as no version can reach it. Releasing
+ *   a long chain is iterative, so dropping a deep version cannot overflow the call stack.
+ * - **Exception Safety**: Popping or peeking at an empty stack throws `std::underflow_error`.
+ *
+ * ## Constraints:
+ * - Reference counts are not synchronized, so all versions of a stack must be used from one
+ *   thread. Stacks that share no nodes may be used on different threads: the node pool they
+ *   share keeps a free list per thread.
+ *
+ * ## Public Methods:
+ * - `PersistentStack()`: Constructs an empty stack.
+ * - `size_t size() const`: Returns the number of elements in this version.
+ * - `bool is_empty() const`: Checks if this version is empty.
+ * - `const T& peek() const`: Returns the item at the top of this version.
+ * - `PersistentStack push(T item) const`: Returns a version with the item added on top.
+ * - `PersistentStack pop() const`: Returns the version below the top item.
+*/
+
+#ifndef PERSISTENT_STACK_H
+#define PERSISTENT_STACK_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+using namespace std;
+
+
+#define NODES_PER_CHUNK 1024
+
+template <typename T>
+class PersistentStack {
+  struct Node {
+    T value;
+    Node* next;
+    size_t depth;
+    size_t references;
+  };
+
+  // Raw storage for nodes, handed out in chunks and recycled through free
+  // lists threaded through the unused slots. There is one pool per element
+  // type, but every thread keeps its own free list, so allocating and
+  // releasing take no lock. The lock is only taken to carve a new chunk or
+  // to pick up the free slots of threads that have exited. Chunks are never
+  // freed, so a node may be released on any thread, onto that thread's list.
+  class NodePool {
+    union Slot {
+      Slot* next_free;
+      alignas(Node) unsigned char node[sizeof(Node)];
+    };
+
+    // Trivially destructible, so that it can still be used while static
+    // stacks are destroyed after the thread's other thread_locals.
+    static inline thread_local Slot* free_list = nullptr;
+
+    // Hands the free list of an exiting thread back to the pool.
+    struct Handoff {
+      ~Handoff() {
+        pool().adopt(exchange(free_list, nullptr));
+      }
+    };
+    static inline thread_local Handoff handoff;
+
+    vector<unique_ptr<Slot[]>> chunks;
+    Slot* orphans = nullptr;
+    mutex lock;
+
+    void adopt(Slot* list) {
+      if (list == nullptr) {
+        return;
+      }
+      Slot* last = list;
+      while (last->next_free != nullptr) {
+        last = last->next_free;
+      }
+      lock_guard<mutex> guard(lock);
+      last->next_free = orphans;
+      orphans = list;
+    }
+
+    void refill() {
+      (void)&handoff;  // Registers this thread's handoff
+      lock_guard<mutex> guard(lock);
+      if (orphans != nullptr) {
+        free_list = exchange(orphans, nullptr);
+        return;
+      }
+      chunks.push_back(make_unique<Slot[]>(NODES_PER_CHUNK));
+      Slot* chunk = chunks.back().get();
+      for (size_t i = 0; i < NODES_PER_CHUNK; i++) {
+        chunk[i].next_free = free_list;
+        free_list = &chunk[i];
+      }
+    }
+
+  public:
+    void* allocate() {
+      if (free_list == nullptr) {
+        refill();
+      }
+      Slot* slot = free_list;
+      free_list = slot->next_free;
+      return slot->node;
+    }
+
+    void release(void* node) {
+      Slot* slot = reinterpret_cast<Slot*>(node);
+      if (free_list == nullptr) {
+        (void)&handoff;  // A thread that only releases must hand off too
+      }
+      slot->next_free = free_list;
+      free_list = slot;
+    }
+  };
+
+  // Never destroyed, so that stacks with static storage duration, which
+  // may be destroyed after any function-local static, can still release
+  // their nodes into it.
+  static NodePool& pool() {
+    static NodePool* shared_pool = new NodePool;
+    return *shared_pool;
+  }
+
+  Node* head;
+
+  explicit PersistentStack(Node* head): head(head) {
+  }
+
+  static Node* retain(Node* node) {
+    if (node != nullptr) {
+      node->references++;
+    }
+    return node;
+  }
+
+  static void release(Node* node) {
+    while (node != nullptr && --node->references == 0) {
+      Node* next = node->next;
+      node->~Node();
+      pool().release(node);
+      node = next;
+    }
+  }
+
+public:
+  PersistentStack(): head(nullptr) {
+  }
+
+  PersistentStack(const PersistentStack<T>& other): head(retain(other.head)) {
+  }
+
+  PersistentStack(PersistentStack<T>&& other) noexcept: head(exchange(other.head, nullptr)) {
+  }
+
+  PersistentStack<T>& operator=(PersistentStack<T> other) noexcept {
+    swap(head, other.head);
+    return *this;
+  }
+
+  ~PersistentStack() {
+    release(head);
+  }
+
+  size_t size() const {
+    return head == nullptr ? 0 : head->depth;
+  }
+
+  bool is_empty() const {
+    return head == nullptr;
+  }
+
+  const T& peek() const {
+    if (is_empty()) {
+      throw underflow_error("cannot peek into empty stack");
+    }
+    return head->value;
+  }
+
+  PersistentStack<T> push(T item) const {
+    void* memory = pool().allocate();
+    Node* node;
+    try {
+      node = new (memory) Node{move(item), head, size() + 1, 1};
+    } catch (...) {
+      pool().release(memory);
+      throw;
+    }
+    retain(head);
+    return PersistentStack<T>(node);
+  }
+
+  PersistentStack<T> pop() const {
+    if (is_empty()) {
+      throw underflow_error("cannot pop from empty stack");
+    }
+    return PersistentStack<T>(retain(head->next));
+  }
+};
+
+#endif
@@ -0,0 +1,110 @@
+#include <iostream>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+#include "persistent_stack.h"
+
+// Destroyed after main returns, possibly after the node pool's own statics
+PersistentStack<string> global_stack;
+
+// -----------------------------------------------------------------------------
+int passed = 0;
+int failed = 0;
+
+void expect(string description, bool condition) {
+  if (condition) passed++; else failed++;
+  cout << description << " " << (condition ? "PASS" : "FAIL") << endl;
+}
+// -----------------------------------------------------------------------------
+
+int main() {
+
+    PersistentStack<string> empty;
+    expect("New persistent stack empty", empty.is_empty());
+    expect("New persistent stack size 0", empty.size() == 0);
+
+    // Pushes return new versions and leave the old ones alone
+    auto one = empty.push("first");
+    auto two = one.push("second");
+    expect("Push leaves original version empty", empty.is_empty());
+    expect("1-element version size 1", one.size() == 1 && one.peek() == "first");
+    expect("2-element version size 2", two.size() == 2 && two.peek() == "second");
+
+    // Pops return the version below
+    auto popped = two.pop();
+    expect("Pop returns version below", popped.size() == 1 && popped.peek() == "first");
+    expect("Pop leaves original version intact", two.size() == 2 && two.peek() == "second");
+
+    // Forks share their tails but diverge above them
+    auto left = two.push("left");
+    auto right = two.push("right");
+    expect("Forks diverge on top", left.peek() == "left" && right.peek() == "right");
+    expect("Forks share their tail", left.pop().peek() == "second" && right.pop().peek() == "second");
+
+    // Copies are versions too
+    PersistentStack<string> copy = left;
+    left = left.pop().pop();
+    expect("Copy keeps its version after the original moves on",
+        copy.size() == 3 && copy.peek() == "left" && left.peek() == "first");
+
+    // Many versions built from one base, then dropped, recycle their nodes
+    PersistentStack<int> base;
+    for (int i = 0; i < 1000; i++) base = base.push(i);
+    vector<PersistentStack<int>> history;
+    for (int i = 0; i < 100; i++) history.push_back(base.push(-i));
+    bool shared_tails = true;
+    for (int i = 0; i < 100; i++) shared_tails = shared_tails && history[i].pop().peek() == 999;
+    expect("Every fork sees the shared base", shared_tails);
+    history.clear();
+    expect("Base survives its forks", base.size() == 1000 && base.peek() == 999);
+
+    // Dropping a deep version does not recurse
+    {
+        PersistentStack<int> deep;
+        for (int i = 0; i < 1000000; i++) deep = deep.push(i);
+        expect("Deep version has expected size", deep.size() == 1000000);
+    }
+
+    // Unrelated stacks may be used on different threads
+    {
+        auto churn = [](int seed, size_t* depth) {
+            PersistentStack<int> own;
+            for (int round = 0; round < 100; round++) {
+                for (int i = 0; i < 1000; i++) own = own.push(seed + i);
+                while (own.size() > 10) own = own.pop();
+            }
+            *depth = own.size() + size_t(own.peek() == seed + 9 ? 0 : 1);
+        };
+        size_t first = 0, second = 0;
+        thread a(churn, 0, &first), b(churn, 1000000, &second);
+        a.join();
+        b.join();
+        expect("Stacks on two threads keep their own nodes", first == 10 && second == 10);
+    }
+    global_stack = global_stack.push("outlives main");
+
+    // Pop and peek when empty are errors
+    bool thrown = false;
+    try {
+        empty.pop();
+    } catch (underflow_error& e) {
+        thrown = true;
+        expect("Underflow exception message is correct",
+             string("cannot pop from empty stack") == e.what());
+    }
+    expect("Pop from empty stack should throw", thrown);
+    thrown = false;
+    try {
+        empty.peek();
+    } catch (underflow_error& e) {
+        thrown = true;
+    }
+    expect("Peek into empty stack should throw", thrown);
+
+    printf("\n%d passed, %d failed\n", passed, failed);
+    return 0;
+}
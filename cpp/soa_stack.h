@@ -0,0 +1,157 @@
+/**
+ * @class SoAStack
+ * @brief A stack of tuples that stores each field in its own array.
+ *
+ * `Stack<pair<int, string>>` interleaves its fields, so reading only the `int`s of a deep stack
+ * still pulls every `string` through the cache. This stack keeps one contiguous array per
+ * field, all resized together with the growth and shrink rules of `Stack`, and exposes each as
+ * a `span` so a scan over one field reads only that field and can be vectorized.
+ *
+ * @tparam Ts The types of the fields of each element.
+ *
+ * ## Key Features:
+ * - **Field Views**: `field<I>()` returns the live elements' `I`th fields, bottom to top, as one
+ *   contiguous `span`.
+ * - **Same Operations as Stack**: Items are pushed and popped whole; `pop()` returns a tuple, and
+ *   a `pair` or `tuple` can be pushed directly.
+ * - **Exception Safety**: Pushing onto a full stack throws `std::overflow_error`; popping an
+ *   empty one throws `std::underflow_error`. Resizing moves each field with the same
+ *   `move_if_noexcept` rule as `Stack`, so a field whose copy throws during growth leaves the
+ *   stack as it was, and a failed shrink keeps the larger arrays.
+ *
+ * ## Constraints:
+ * - Copying is deleted, as for `Stack`.
+ * - A span from `field<I>()` is invalidated by the next push or pop that resizes the stack.
+ *
+ * ## Public Methods:
+ * - `SoAStack()`: Constructs an empty stack with an initial capacity.
+ * - `size_t size() const`: Returns the current number of elements in the stack.
+ * - `bool is_empty() const`: Checks if the stack is empty.
+ * - `bool is_full() const`: Checks if the stack has reached `MAX_CAPACITY`.
+ * - `void push(Ts... fields)`, `void push(tuple<Ts...> item)`: Adds an item to the top.
+ * - `tuple<Ts...> pop()`: Removes and returns the item at the top of the stack.
+ * - `span<const T> field<I>() const`: Returns a view of field `I` of every element.
+*/
+
+#ifndef SOA_STACK_H
+#define SOA_STACK_H
+
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include "stack.h"
+using namespace std;
+
+
+template <typename... Ts>
+class SoAStack {
+  template <size_t I>
+  using Field = tuple_element_t<I, tuple<Ts...>>;
+
+  tuple<unique_ptr<Ts[]>...> fields;
+  size_t capacity;
+  size_t top;
+
+  SoAStack(const SoAStack<Ts...>&) = delete;
+  SoAStack<Ts...>& operator=(const SoAStack<Ts...>&) = delete;
+
+public:
+  SoAStack():
+    fields(make_unique<Ts[]>(INITIAL_CAPACITY)...),
+    capacity(INITIAL_CAPACITY),
+    top(0) {
+  }
+
+  size_t size() const {
+    return top;
+  }
+
+  bool is_empty() const {
+    return top == 0;
+  }
+
+  bool is_full() const {
+    return top == size_t(MAX_CAPACITY);
+  }
+
+  void push(Ts... items) {
+    if (top == size_t(MAX_CAPACITY)) {
+      throw overflow_error("Stack has reached maximum capacity");
+    }
+    if (top == capacity) {
+      reallocate(2 * capacity, index_sequence_for<Ts...>());
+    }
+    store(index_sequence_for<Ts...>(), move(items)...);
+    top++;
+  }
+
+  void push(tuple<Ts...> item) {
+    apply([this](Ts&... items) { push(move(items)...); }, item);
+  }
+
+  tuple<Ts...> pop() {
+    if (is_empty()) {
+      throw underflow_error("cannot pop from empty stack");
+    }
+    top--;
+    tuple<Ts...> popped_value = take(index_sequence_for<Ts...>());
+    if (top <= capacity / 4 && capacity / 2 >= INITIAL_CAPACITY) {
+      // As in Stack, a failed shrink only costs the memory it would save
+      try {
+        reallocate(capacity / 2, index_sequence_for<Ts...>());
+      } catch (...) {
+      }
+    }
+    return popped_value;
+  }
+
+  template <size_t I>
+  span<const Field<I>> field() const {
+    return span<const Field<I>>(get<I>(fields).get(), top);
+  }
+
+private:
+  template <size_t... Is>
+  void store(index_sequence<Is...>, Ts&&... items) {
+    ((get<Is>(fields)[top] = move(items)), ...);
+  }
+
+  // Reads the element at `top` out of every array, then resets the slots
+  // so that they release whatever the element held, as `Stack::pop` does.
+  template <size_t... Is>
+  tuple<Ts...> take(index_sequence<Is...>) {
+    tuple<Ts...> value(move(get<Is>(fields)[top])...);
+    ((get<Is>(fields)[top] = Ts()), ...);
+    return value;
+  }
+
+  // Fields are moved into the new arrays unless moving could throw, in which
+  // case they are copied, as Stack resizes with move_if_noexcept. The copies
+  // are made first and the moves only once they have all succeeded, so a
+  // throw leaves every old field intact.
+  template <size_t... Is>
+  void reallocate(size_t new_capacity, index_sequence<Is...>) {
+    new_capacity = max(size_t(INITIAL_CAPACITY), min(new_capacity, size_t(MAX_CAPACITY)));
+    tuple<unique_ptr<Ts[]>...> new_fields(make_unique_for_overwrite<Ts[]>(new_capacity)...);
+    (transfer<Is, false>(new_fields), ...);
+    (transfer<Is, true>(new_fields), ...);
+    fields = move(new_fields);
+    capacity = new_capacity;
+  }
+
+  template <size_t I, bool nothrow_move>
+  void transfer(tuple<unique_ptr<Ts[]>...>& new_fields) {
+    if constexpr (is_nothrow_move_assignable_v<Field<I>> == nothrow_move) {
+      Field<I>* from = get<I>(fields).get();
+      if constexpr (nothrow_move) {
+        move(from, from + top, get<I>(new_fields).get());
+      } else {
+        copy(from, from + top, get<I>(new_fields).get());
+      }
+    }
+  }
+};
+
+#endif
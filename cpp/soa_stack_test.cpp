@@ -0,0 +1,142 @@
+#include <iostream>
+#include <cassert>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+using namespace std;
+
+#include "soa_stack.h"
+
+// -----------------------------------------------------------------------------
+int passed = 0;
+int failed = 0;
+
+void expect(string description, bool condition) {
+  if (condition) passed++; else failed++;
+  cout << description << " " << (condition ? "PASS" : "FAIL") << endl;
+}
+// -----------------------------------------------------------------------------
+
+// Counts copies; its move cannot throw, so resizing should never copy it.
+struct Tracked {
+  static inline int copies = 0;
+  int value;
+  Tracked(int value = 0): value(value) {}
+  Tracked(const Tracked& other): value(other.value) { copies++; }
+  Tracked(Tracked&& other) noexcept: value(other.value) {}
+  Tracked& operator=(const Tracked& other) { value = other.value; copies++; return *this; }
+  Tracked& operator=(Tracked&& other) noexcept { value = other.value; return *this; }
+};
+
+// Copying throws once `copies_left` runs out, and moving may throw, so
+// resizing has to copy it.
+struct Fragile {
+  static inline int copies_left = 1 << 30;
+  int value;
+  Fragile(int value = 0): value(value) {}
+  Fragile(const Fragile& other): value(other.value) {}
+  Fragile& operator=(const Fragile& other) {
+    if (copies_left-- == 0) throw runtime_error("copy failed");
+    value = other.value;
+    return *this;
+  }
+  Fragile& operator=(Fragile&& other) { value = other.value; return *this; }
+};
+
+int main() {
+
+    SoAStack<int, string> ps;
+    expect("New SoA stack empty", ps.is_empty() && ps.size() == 0);
+    expect("New SoA stack not full", !ps.is_full());
+    expect("New SoA stack has empty fields", ps.field<0>().empty() && ps.field<1>().empty());
+
+    // Items go in whole and come out whole
+    ps.push(5, "world");
+    ps.push(make_pair(7, "hello"));
+    expect("Size after pushes", ps.size() == 2);
+    expect("Pop returns the top item", ps.pop() == make_tuple(7, string("hello")));
+    expect("Pop leaves the item below", ps.size() == 1 && get<1>(ps.pop()) == "world");
+
+    // Each field is one contiguous array, bottom to top
+    for (int i = 0; i < 100; i++) ps.push(i, to_string(i));
+    span<const int> numbers = ps.field<0>();
+    span<const string> names = ps.field<1>();
+    expect("Field views cover every element", numbers.size() == 100 && names.size() == 100);
+    expect("Field views are in push order", numbers[0] == 0 && numbers[99] == 99 && names[42] == "42");
+    expect("Scanning one field", accumulate(numbers.begin(), numbers.end(), 0) == 4950);
+
+    // Resizing keeps the fields in step
+    bool in_step = true;
+    for (int i = 99; i >= 0; i--) {
+        auto [number, name] = ps.pop();
+        in_step = in_step && number == i && name == to_string(i);
+    }
+    expect("Fields stay paired across shrinking", in_step && ps.is_empty());
+
+    // More than two fields
+    SoAStack<char, double, long> triples;
+    triples.push('a', 1.5, 10L);
+    triples.push(make_tuple('b', 2.5, 20L));
+    expect("Three-field stack keeps each field", triples.field<1>()[1] == 2.5 && triples.field<2>()[0] == 10);
+
+    // Push to full stack is an error
+    bool thrown = false;
+    try {
+        for (int i = 0; i < MAX_CAPACITY + 1; i++) {
+            triples.push('x', 0.0, i);
+        }
+    } catch (overflow_error& e) {
+        thrown = true;
+        expect("Overflow exception message is correct",
+             string("Stack has reached maximum capacity") == e.what());
+    }
+    expect("Push to full stack should throw", thrown);
+    expect("Full stack is full", triples.is_full());
+
+    // Resizing moves fields that move without throwing
+    {
+        SoAStack<Tracked, string> moved;
+        for (int i = 0; i < 1000; i++) moved.push(Tracked(i), to_string(i));
+        Tracked::copies = 0;
+        for (int i = 0; i < 1000; i++) moved.push(Tracked(i), to_string(i));
+        while (moved.size() > 1) moved.pop();
+        expect("Resizing never copies nothrow-movable fields", Tracked::copies == 0);
+        auto [bottom, bottom_name] = moved.pop();
+        expect("Moved fields keep their values", bottom.value == 0 && bottom_name == "0");
+    }
+
+    // A copy that throws during growth leaves every field as it was
+    {
+        SoAStack<string, Fragile> fragile;
+        for (int i = 0; i < INITIAL_CAPACITY; i++) fragile.push(to_string(i), Fragile(i));
+        Fragile::copies_left = INITIAL_CAPACITY / 2;
+        thrown = false;
+        try {
+            fragile.push("overflow", Fragile(-1));
+        } catch (runtime_error& e) {
+            thrown = true;
+        }
+        Fragile::copies_left = 1 << 30;
+        expect("Throwing copy during growth propagates", thrown && fragile.size() == INITIAL_CAPACITY);
+        bool intact = true;
+        for (int i = INITIAL_CAPACITY - 1; i >= 0; i--) {
+            auto [name, item] = fragile.pop();
+            intact = intact && name == to_string(i) && item.value == i;
+        }
+        expect("Failed growth leaves every field intact", intact);
+    }
+
+    // Pop from empty stack is an error
+    thrown = false;
+    try {
+        ps.pop();
+    } catch (underflow_error& e) {
+        thrown = true;
+        expect("Underflow exception message is correct",
+             string("cannot pop from empty stack") == e.what());
+    }
+    expect("Pop from empty stack should throw", thrown);
+
+    printf("\n%d passed, %d failed\n", passed, failed);
+    return 0;
+}
@@ -13,57 +13,298 @@
  * - **Capacity Limits**: The stack starts with an initial capacity and can grow up to a defined 
  *   maximum capacity.
  * - **Exception Safety**: Provides strong exception guarantees for invalid operations 
- *   (e.g., pushing onto a full stack or popping from an empty stack).
+ *   (e.g., pushing onto a full stack or popping from an empty stack), and for elements whose
+ *   copy or move throws while the stack is being resized.
  *
  * ## Constraints:
  * - Copy constructor and assignment operator are deleted to prevent accidental copying 
  *   and to ensure resource management integrity.
+ * - Moving is allowed and O(1): it transfers the buffer, leaving the source empty but valid.
+ *   A moved-from stack has no buffer and allocates one on its next push, as a new one does.
  *
  * ## Public Methods:
- * - `Stack()`: Constructs an empty stack with an initial capacity.
- * - `int size() const`: Returns the current number of elements in the stack.
+ * - `Stack()`: Constructs an empty stack without allocating. The first push allocates room for
+ *   `INITIAL_CAPACITY` items, so stacks that are never pushed to cost nothing but their size.
+ * - `explicit Stack(size_t initial_capacity)`: Constructs an empty stack with room for
+ *   `initial_capacity` items, as if `reserve(initial_capacity)` had been called.
+ * - `Stack(Stack&&)`, `operator=(Stack&&)`: Take over another stack's buffer without copying.
+ * - `void swap(Stack& other)`: Exchanges the contents of two stacks in O(1).
+ * - `size_t size() const`: Returns the current number of elements in the stack.
  * - `bool is_empty() const`: Checks if the stack is empty.
- * - `bool is_full() const`: Checks if the stack is full.
+ * - `bool is_full() const`: Checks if the stack is full, i.e. has reached `MAX_CAPACITY`.
+ * - `size_t capacity() const`: Returns how many items fit before the next reallocation.
+ * - `void reserve(size_t n)`: Grows the buffer to hold at least `n` items, and keeps pops and
+ *   rollbacks from shrinking it below that, so a stack whose depth stays within `n` never
+ *   reallocates. Throws `std::overflow_error` if `n` exceeds `MAX_CAPACITY`.
+ * - `void shrink_to_fit()`: Drops any reservation and shrinks the buffer to the current size,
+ *   or `INITIAL_CAPACITY` if that is larger. A failed reallocation leaves the buffer as it was.
  * - `void push(T item)`: Adds an item to the top of the stack. Throws `std::overflow_error` 
  *   if the stack exceeds its maximum capacity.
  * - `T pop()`: Removes and returns the item at the top of the stack. Throws `std::underflow_error` 
  *   if the stack is empty.
+ * - `void push_unchecked(T item)`, `T pop_unchecked()`: Push and pop with no checks and no
+ *   resizing, for loops whose depth is already known to be in bounds. The caller guarantees
+ *   that the buffer has room for the push, i.e. that the stack has been at least this deep
+ *   since it last shrank, and that the stack is not empty for the pop. Both are checked with
+ *   `assert` in builds without `NDEBUG`. `pop_unchecked` never shrinks the buffer.
+ * - `size_t mark() const`: Returns a token for the current depth, to roll back to later.
+ * - `void rollback(size_t mark)`: Discards every item pushed since `mark()` returned the token,
+ *   in one pass and with at most one shrink. Nothing is copied out, and for trivially
+ *   destructible types it is pure pointer arithmetic. Throws `std::out_of_range` if the stack
+ *   is already below the mark.
  *
  * ## Private Methods:
- * - `void reallocate(int new_capacity)`: Resizes the internal storage to the specified capacity, 
- *   constrained by the defined maximum and initial capacities.
+ * - `void reallocate(size_t new_capacity)`: Resizes the internal storage to the specified capacity, 
+ *   constrained by the defined maximum and initial capacities. Types for which
+ *   `trivially_relocatable<T>` holds are resized with `realloc`, which can grow the buffer in
+ *   place or remap its pages. Others are moved into a new buffer, or copied if their move
+ *   constructor may throw, so that if it fails the stack is left exactly as it was.
+ * - `void shrink(size_t new_capacity)`: Reallocates to a smaller capacity after a pop or a
+ *   rollback. A failure is ignored, leaving the larger buffer in place.
+ *
+ * ## Buffer Pool:
+ * - `StackBufferPool::set_limit(bytes)` lets the calling thread keep up to `bytes` of freed
+ *   stack buffers for reuse. While it is nonzero, buffers that a resize or a destructor lets go
+ *   of are kept, and allocations are served from them first, so stacks created and destroyed
+ *   per request reuse the same few buffers. Buffers of any size are kept, except for
+ *   over-aligned types, and while the pool is on, relocatable types are moved with `memcpy`
+ *   instead of `realloc`. `StackBufferPool::retained_bytes()` reports what is currently held.
+ *
+ * ## Relocation:
+ * - `trivially_relocatable<T>` is true for trivially copyable types, for `unique_ptr` with the
+ *   default deleter, `shared_ptr`, pairs of relocatable types and, on libc++, `basic_string`. A
+ *   type that owns no pointer into itself can opt in by specializing it.
  *
  * ## Constants:
- * - `MAX_CAPACITY`: The maximum allowed capacity of the stack (32,768 by default).
- * - `INITIAL_CAPACITY`: The initial capacity of the stack (16 by default).
+ * - `MAX_CAPACITY`: The maximum allowed capacity of the stack (32,768 by default). It can be raised
+ *   up to the address-space limit by defining it before this header is included, or with
+ *   e.g. `-DMAX_CAPACITY=4294967296`. Sizes and indices are `size_t` throughout.
+ * - `INITIAL_CAPACITY`: The capacity allocated by the first push (16 by default).
+ *
+ * ## Stack<bool>:
+ * Flags are packed 64 to a word, an eighth of the memory of one byte each, so zeroing a new
+ * buffer touches an eighth as much memory too. Pushing and popping a flag are branch-free bit
+ * operations, and `uint64_t pop_n(size_t n)` removes the top `n` (at most 64) flags at once,
+ * returning them as a bitmask whose bit `n - 1` is the former top and bit 0 the deepest flag
+ * removed. It throws `std::underflow_error` if fewer than `n` flags are on the stack.
 */
 
+#ifndef STACK_H
+#define STACK_H
+
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
 #include <stdexcept>
 #include <string>
 #include <memory>
+#include <type_traits>
+#include <utility>
 using namespace std;
 
 
+#ifndef MAX_CAPACITY
 #define MAX_CAPACITY 32768
+#endif
 #define INITIAL_CAPACITY 16
+#define STACK_POOL_CLASSES 64
+
+// Allocates `count` words of flags for a Stack<bool>. Tests may define it
+// before including this header to make allocations fail on demand.
+#ifndef STACK_ALLOCATE_WORDS
+#define STACK_ALLOCATE_WORDS(count) make_unique<uint64_t[]>(count)
+#endif
+
+// Whether a T can be moved to a new address by copying its bytes and
+// forgetting the original, so that growing a buffer of them can be left to
+// realloc. True for trivially copyable types; other types can opt in by
+// specializing this for themselves.
+template <typename T>
+struct trivially_relocatable : bool_constant<is_trivially_copyable_v<T>> {};
+
+template <typename T, typename Deleter>
+struct trivially_relocatable<unique_ptr<T, Deleter>> : trivially_relocatable<Deleter> {};
+
+template <typename T>
+struct trivially_relocatable<default_delete<T>> : true_type {};
+
+template <typename T>
+struct trivially_relocatable<shared_ptr<T>> : true_type {};
+
+template <typename First, typename Second>
+struct trivially_relocatable<pair<First, Second>>
+  : bool_constant<trivially_relocatable<First>::value && trivially_relocatable<Second>::value> {};
+
+// libc++ strings hold no pointer into themselves. libstdc++ strings point
+// into their own small-string buffer, so they must stay on the copy path.
+#ifdef _LIBCPP_VERSION
+template <typename Char, typename Traits, typename Allocator>
+struct trivially_relocatable<basic_string<Char, Traits, Allocator>> : true_type {};
+#endif
+
+template <typename T>
+inline constexpr bool trivially_relocatable_v = trivially_relocatable<T>::value;
+
+template <typename T>
+class Stack;
+
+// Free lists of stack buffers, one set per thread, with buffers filed by
+// the power of two at or below their size in bytes. Off until `set_limit`
+// gives it a budget; while it is on, every Stack on the thread takes its
+// buffers from here and hands them back on resize or destruction, instead
+// of going to malloc and free each time. Each free buffer records its own
+// size, so any element type and capacity can be pooled.
+class StackBufferPool {
+  struct FreeBuffer {
+    FreeBuffer* next;
+    size_t bytes;
+  };
+
+  struct Lists {
+    FreeBuffer* heads[STACK_POOL_CLASSES] = {};
+    size_t retained = 0;
+    size_t limit = 0;
+
+    ~Lists() {
+      limit = 0;
+      trim(0);
+    }
+
+    // Frees the largest buffers first until at most `bytes` are retained.
+    void trim(size_t bytes) {
+      for (size_t size_class = STACK_POOL_CLASSES; size_class-- > 0 && retained > bytes;) {
+        while (heads[size_class] != nullptr && retained > bytes) {
+          FreeBuffer* buffer = exchange(heads[size_class], heads[size_class]->next);
+          retained -= buffer->bytes;
+          free(buffer);
+        }
+      }
+    }
+  };
+
+  static Lists& lists() {
+    static thread_local Lists pool;
+    return pool;
+  }
+
+  // Returns a retained buffer of at least `bytes`, or null if there is none.
+  // Only the list `bytes` is filed under is searched, so what comes back is
+  // less than twice the size asked for; stacks of one element type mostly
+  // find an exact fit at the head.
+  static void* take(size_t bytes) {
+    Lists& pool = lists();
+    if (pool.retained == 0 || bytes < sizeof(FreeBuffer)) {
+      return nullptr;
+    }
+    for (FreeBuffer** link = &pool.heads[bit_width(bytes) - 1]; *link != nullptr; link = &(*link)->next) {
+      if ((*link)->bytes >= bytes) {
+        FreeBuffer* buffer = exchange(*link, (*link)->next);
+        pool.retained -= buffer->bytes;
+        return buffer;
+      }
+    }
+    return nullptr;
+  }
+
+  // Keeps a malloc'd buffer of at least `bytes` for reuse if the budget
+  // allows, returning whether it did; if not, the caller still owns it.
+  static bool give(void* memory, size_t bytes) {
+    Lists& pool = lists();
+    if (memory == nullptr || bytes < sizeof(FreeBuffer) || pool.retained + bytes > pool.limit) {
+      return false;
+    }
+    FreeBuffer*& head = pool.heads[bit_width(bytes) - 1];
+    head = new (memory) FreeBuffer{head, bytes};
+    pool.retained += bytes;
+    return true;
+  }
+
+  template <typename T>
+  friend class Stack;
+
+public:
+  // Sets how many bytes of free buffers this thread may keep, freeing the
+  // largest until the new budget is met. 0, the default, turns pooling off.
+  static void set_limit(size_t bytes) {
+    lists().limit = bytes;
+    lists().trim(bytes);
+  }
+
+  static size_t limit() {
+    return lists().limit;
+  }
+
+  static size_t retained_bytes() {
+    return lists().retained;
+  }
+};
 
 template <typename T>
 class Stack {
-  unique_ptr<T[]> elements;
-  int capacity;
-  int top;
+  // Only the first `top` slots hold live elements; the rest are raw memory.
+  T* elements;
+  size_t allocated;
+  size_t top;
+  // Pops do not shrink the buffer below this, so a reserved stack keeps its size
+  size_t reserved;
+
+  static constexpr bool grows_with_realloc =
+    trivially_relocatable_v<T> && alignof(T) <= alignof(max_align_t);
 
   Stack(const Stack<T>&) = delete;
   Stack<T>& operator=(const Stack<T>&) = delete; 
   
 public:
-  Stack():
+  // A null buffer of capacity 0 stands for every empty stack; the first
+  // push finds it full and allocates INITIAL_CAPACITY.
+  Stack() noexcept:
+    elements(nullptr),
+    allocated(0),
+    top(0),
+    reserved(0) {
+    }
+
+  explicit Stack(size_t initial_capacity):
+    elements(allocate(checked_reservation(initial_capacity))),
+    allocated(max(size_t(INITIAL_CAPACITY), initial_capacity)),
     top(0),
-    capacity(INITIAL_CAPACITY),
-    elements(make_unique<T[]>(INITIAL_CAPACITY)) {
+    reserved(initial_capacity) {
+    }
+
+  Stack(Stack<T>&& other) noexcept:
+    elements(exchange(other.elements, nullptr)),
+    allocated(exchange(other.allocated, 0)),
+    top(exchange(other.top, 0)),
+    reserved(exchange(other.reserved, 0)) {
     }
 
-  int size() const {
+  Stack<T>& operator=(Stack<T>&& other) noexcept {
+    Stack<T>(move(other)).swap(*this);
+    return *this;
+  }
+
+  ~Stack() {
+    destroy(0, top);
+    release(elements, allocated);
+  }
+
+  void swap(Stack<T>& other) noexcept {
+    using std::swap;
+    swap(elements, other.elements);
+    swap(allocated, other.allocated);
+    swap(top, other.top);
+    swap(reserved, other.reserved);
+  }
+
+  friend void swap(Stack<T>& a, Stack<T>& b) noexcept {
+    a.swap(b);
+  }
+
+  size_t size() const {
     return top;
   }
 
@@ -72,37 +313,369 @@ public:
   }
 
   bool is_full() const {
-    return top == capacity;
+    return top == size_t(MAX_CAPACITY);
+  }
+
+  size_t capacity() const {
+    return allocated;
+  }
+
+  void reserve(size_t new_capacity) {
+    checked_reservation(new_capacity);
+    reserved = max(reserved, new_capacity);
+    if (new_capacity > allocated) {
+      reallocate(new_capacity);
+    }
+  }
+
+  void shrink_to_fit() {
+    reserved = 0;
+    if (allocated > max(size_t(INITIAL_CAPACITY), top)) {
+      shrink(top);
+    }
   }
 
   void push(T item) {
-    if (top == MAX_CAPACITY) {
+    if (top == size_t(MAX_CAPACITY)) {
       throw overflow_error("Stack has reached maximum capacity");
     }
-    if (top == capacity) {
-      reallocate(2 * capacity);
+    if (top == allocated) {
+      reallocate(2 * allocated);
     }
-    elements[top++] = item;
+    new (&elements[top]) T(move(item));
+    top++;
   }
 
   T pop() {
     if (is_empty()) {
       throw underflow_error("cannot pop from empty stack");
     }
-    T popped_value = elements[--top];
-    elements[top] = T();
-    if (top <= capacity / 4 && capacity / 2 >= INITIAL_CAPACITY) {
-      reallocate(max(capacity / 2, INITIAL_CAPACITY));
+    T popped_value = move(elements[top - 1]);
+    elements[--top].~T();
+    if (top <= allocated / 4 && allocated / 2 >= minimum_capacity()) {
+      shrink(allocated / 2);
     }
     return popped_value;
   }
 
+  void push_unchecked(T item) {
+    assert(top < allocated);
+    new (&elements[top]) T(move(item));
+    top++;
+  }
+
+  T pop_unchecked() {
+    assert(top > 0);
+    T popped_value = move(elements[--top]);
+    elements[top].~T();
+    return popped_value;
+  }
+
+  size_t mark() const {
+    return top;
+  }
+
+  void rollback(size_t mark) {
+    if (mark > top) {
+      throw out_of_range("cannot roll back to a mark above the top");
+    }
+    destroy(mark, top);
+    top = mark;
+    size_t new_capacity = allocated;
+    while (top <= new_capacity / 4 && new_capacity / 2 >= minimum_capacity()) {
+      new_capacity /= 2;
+    }
+    if (new_capacity != allocated) {
+      shrink(new_capacity);
+    }
+  }
+
 private:
-  void reallocate(int new_capacity) {
-    new_capacity = max(INITIAL_CAPACITY, min(new_capacity, MAX_CAPACITY));
-    unique_ptr<T[]> new_elements = make_unique<T[]>(new_capacity);
-    copy(&elements[0], &elements[top], &new_elements[0]);
-    elements = move(new_elements);
-    capacity = new_capacity;
+  static size_t checked_reservation(size_t new_capacity) {
+    if (new_capacity > size_t(MAX_CAPACITY)) {
+      throw overflow_error("cannot reserve beyond maximum capacity");
+    }
+    return max(size_t(INITIAL_CAPACITY), new_capacity);
+  }
+
+  size_t minimum_capacity() const {
+    return max(size_t(INITIAL_CAPACITY), reserved);
+  }
+
+  static T* allocate(size_t count) {
+    if constexpr (alignof(T) <= alignof(max_align_t)) {
+      if (void* pooled = StackBufferPool::take(count * sizeof(T))) {
+        return static_cast<T*>(pooled);
+      }
+    }
+    void* memory = alignof(T) > alignof(max_align_t)
+      ? aligned_alloc(alignof(T), count * sizeof(T))
+      : malloc(count * sizeof(T));
+    if (memory == nullptr) {
+      throw bad_alloc();
+    }
+    return static_cast<T*>(memory);
+  }
+
+  // Hands a buffer of `count` slots back to the thread's pool, or frees it.
+  static void release(T* buffer, size_t count) {
+    if constexpr (alignof(T) <= alignof(max_align_t)) {
+      if (StackBufferPool::give(buffer, count * sizeof(T))) {
+        return;
+      }
+    }
+    free(buffer);
+  }
+
+  void destroy(size_t from, size_t to) {
+    if constexpr (!is_trivially_destructible_v<T>) {
+      for (size_t i = from; i < to; i++) {
+        elements[i].~T();
+      }
+    }
+  }
+
+  void reallocate(size_t new_capacity) {
+    new_capacity = max(size_t(INITIAL_CAPACITY), min(new_capacity, size_t(MAX_CAPACITY)));
+    if constexpr (grows_with_realloc) {
+      if (StackBufferPool::limit() > 0) {
+        // Buffers go through the pool so that they can be reused, but the
+        // elements still move with a single memcpy.
+        T* new_elements = allocate(new_capacity);
+        if (top > 0) {
+          memcpy(static_cast<void*>(new_elements), static_cast<void*>(elements), top * sizeof(T));
+        }
+        release(elements, allocated);
+        elements = new_elements;
+      } else {
+        // The elements' bytes are all there is to them, so the allocator may
+        // resize in place, or remap pages, instead of copying element-wise.
+        void* memory = realloc(static_cast<void*>(elements), new_capacity * sizeof(T));
+        if (memory == nullptr) {
+          throw bad_alloc();
+        }
+        elements = static_cast<T*>(memory);
+      }
+    } else {
+      // Elements are moved unless moving could throw and copying can't, in
+      // which case they are copied, so a failure leaves the old buffer whole.
+      T* new_elements = allocate(new_capacity);
+      size_t constructed = 0;
+      try {
+        for (; constructed < top; constructed++) {
+          new (&new_elements[constructed]) T(move_if_noexcept(elements[constructed]));
+        }
+      } catch (...) {
+        for (size_t i = 0; i < constructed; i++) {
+          new_elements[i].~T();
+        }
+        release(new_elements, new_capacity);
+        throw;
+      }
+      destroy(0, top);
+      release(elements, allocated);
+      elements = new_elements;
+    }
+    allocated = new_capacity;
+  }
+
+  // Shrinking only saves memory, so if it fails the stack keeps its larger
+  // buffer rather than lose an element that has already been popped.
+  void shrink(size_t new_capacity) noexcept {
+    try {
+      reallocate(new_capacity);
+    } catch (...) {
+    }
   }
 };
+
+template <>
+class Stack<bool> {
+  // One spare word past the end lets pop_n read two words unconditionally
+  unique_ptr<uint64_t[]> words;
+  size_t allocated;
+  size_t top;
+  size_t reserved;
+
+  Stack(const Stack<bool>&) = delete;
+  Stack<bool>& operator=(const Stack<bool>&) = delete;
+
+public:
+  Stack() noexcept:
+    allocated(0),
+    top(0),
+    reserved(0) {
+    }
+
+  explicit Stack(size_t initial_capacity):
+    words(STACK_ALLOCATE_WORDS((checked_reservation(initial_capacity) + 63) / 64 + 1)),
+    allocated(max(size_t(64), initial_capacity)),
+    top(0),
+    reserved(initial_capacity) {
+    }
+
+  Stack(Stack<bool>&& other) noexcept:
+    words(move(other.words)),
+    allocated(exchange(other.allocated, 0)),
+    top(exchange(other.top, 0)),
+    reserved(exchange(other.reserved, 0)) {
+    }
+
+  Stack<bool>& operator=(Stack<bool>&& other) noexcept {
+    Stack<bool>(move(other)).swap(*this);
+    return *this;
+  }
+
+  void swap(Stack<bool>& other) noexcept {
+    using std::swap;
+    swap(words, other.words);
+    swap(allocated, other.allocated);
+    swap(top, other.top);
+    swap(reserved, other.reserved);
+  }
+
+  friend void swap(Stack<bool>& a, Stack<bool>& b) noexcept {
+    a.swap(b);
+  }
+
+  size_t size() const {
+    return top;
+  }
+
+  bool is_empty() const {
+    return top == 0;
+  }
+
+  bool is_full() const {
+    return top == size_t(MAX_CAPACITY);
+  }
+
+  size_t capacity() const {
+    return allocated;
+  }
+
+  void reserve(size_t new_capacity) {
+    checked_reservation(new_capacity);
+    reserved = max(reserved, new_capacity);
+    if (new_capacity > allocated) {
+      reallocate(new_capacity);
+    }
+  }
+
+  void shrink_to_fit() {
+    reserved = 0;
+    if (allocated > max(size_t(64), top)) {
+      shrink(top);
+    }
+  }
+
+  void push(bool item) {
+    if (top == size_t(MAX_CAPACITY)) {
+      throw overflow_error("Stack has reached maximum capacity");
+    }
+    if (top == allocated) {
+      reallocate(2 * allocated);
+    }
+    uint64_t& word = words[top / 64];
+    uint64_t bit = uint64_t(1) << (top % 64);
+    word = (word & ~bit) | (uint64_t(item) << (top % 64));
+    top++;
+  }
+
+  bool pop() {
+    if (is_empty()) {
+      throw underflow_error("cannot pop from empty stack");
+    }
+    top--;
+    bool popped_value = (words[top / 64] >> (top % 64)) & 1;
+    shrink_if_sparse();
+    return popped_value;
+  }
+
+  void push_unchecked(bool item) {
+    assert(top < allocated);
+    uint64_t& word = words[top / 64];
+    word = (word & ~(uint64_t(1) << (top % 64))) | (uint64_t(item) << (top % 64));
+    top++;
+  }
+
+  bool pop_unchecked() {
+    assert(top > 0);
+    top--;
+    return (words[top / 64] >> (top % 64)) & 1;
+  }
+
+  uint64_t pop_n(size_t n) {
+    if (n > 64) {
+      throw invalid_argument("cannot pop more than 64 flags at once");
+    }
+    if (n > top) {
+      throw underflow_error("cannot pop from empty stack");
+    }
+    if (n == 0) {
+      return 0;
+    }
+    top -= n;
+    size_t shift = top % 64;
+    uint64_t low = words[top / 64] >> shift;
+    // Shifting in two steps keeps the shift below 64 when `shift` is 0
+    uint64_t high = (words[top / 64 + 1] << 1) << (63 - shift);
+    uint64_t mask = n == 64 ? ~uint64_t(0) : (uint64_t(1) << n) - 1;
+    uint64_t popped_value = (low | high) & mask;
+    shrink_if_sparse();
+    return popped_value;
+  }
+
+  size_t mark() const {
+    return top;
+  }
+
+  void rollback(size_t mark) {
+    if (mark > top) {
+      throw out_of_range("cannot roll back to a mark above the top");
+    }
+    top = mark;
+    size_t new_capacity = allocated;
+    while (top <= new_capacity / 4 && new_capacity / 2 >= max(size_t(64), reserved)) {
+      new_capacity /= 2;
+    }
+    if (new_capacity != allocated) {
+      shrink(new_capacity);
+    }
+  }
+
+private:
+  static size_t checked_reservation(size_t new_capacity) {
+    if (new_capacity > size_t(MAX_CAPACITY)) {
+      throw overflow_error("cannot reserve beyond maximum capacity");
+    }
+    return max(size_t(64), new_capacity);
+  }
+
+  void shrink_if_sparse() {
+    if (top <= allocated / 4 && allocated / 2 >= max(size_t(64), reserved)) {
+      shrink(allocated / 2);
+    }
+  }
+
+  // As for Stack<T>: the flags are already popped, so a failed shrink
+  // keeps the larger buffer instead of losing them.
+  void shrink(size_t new_capacity) noexcept {
+    try {
+      reallocate(new_capacity);
+    } catch (...) {
+    }
+  }
+
+  // Capacities are whole words, so never fewer than 64 flags.
+  void reallocate(size_t new_capacity) {
+    new_capacity = max(size_t(64), min(new_capacity, size_t(MAX_CAPACITY)));
+    size_t new_words = (new_capacity + 63) / 64 + 1;
+    unique_ptr<uint64_t[]> new_elements = STACK_ALLOCATE_WORDS(new_words);
+    copy(words.get(), words.get() + (top + 63) / 64, new_elements.get());
+    words = move(new_elements);
+    allocated = new_capacity;
+  }
+};
+
+#endif
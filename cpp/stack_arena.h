@@ -0,0 +1,213 @@
+/**
+ * @class StackArena
+ * @brief A pool of many small stacks, addressed by 32-bit handles, sharing one buffer.
+ *
+ * Each stack is an 8-byte header: a 32-bit offset into the arena's buffer, its size, and
+ * the size class of its block. A new stack owns no storage at all; its first push takes a
+ * block of two elements, and it moves to a block twice as large each time it fills up, or
+ * half as large once it is a quarter full, just as `Stack` resizes. Blocks come from the
+ * free list of their size class when one has been released, and are carved off the end of
+ * the buffer otherwise. Handles are indices into the header table, so they stay valid as
+ * the buffer grows, and they are handed out in order from 0: the stacks for the vertices of a
+ * graph, created in vertex order, can be addressed by vertex number.
+ *
+ * @tparam T The type of elements to store in the stacks. Blocks are moved bytewise and a
+ *           reset simply forgets them, so T must be trivially copyable.
+ *
+ * ## Key Features:
+ * - **Compact Headers**: An empty stack costs 8 bytes, against 32 bytes for an empty `Stack`.
+ * - **Lazy Storage**: As with `Stack`, no memory is set aside for a stack until its first push,
+ *   which then takes a block of two elements rather than `Stack`'s separate 16-element buffer.
+ * - **O(1) Reset**: `reset()` drops every stack and all their storage at once, keeping the
+ *   buffer for reuse.
+ * - **Exception Safety**: Popping an empty stack throws `std::underflow_error`. Growing a
+ *   stack past 2^26 elements, or the arena past 2^32 elements, throws `std::overflow_error`,
+ *   and a push that throws leaves every stack as it was. A pop never fails for lack of
+ *   memory: a stack that cannot shrink keeps its larger block.
+ *
+ * ## Constraints:
+ * - Handles are only meaningful to the arena that created them, and only until its next
+ *   `reset()`.
+ *
+ * ## Public Methods:
+ * - `StackArena()`: Constructs an arena with no stacks.
+ * - `Handle create()`: Adds an empty stack and returns its handle.
+ * - `size_t stacks() const`: Returns how many stacks the arena holds.
+ * - `size_t size(Handle stack) const`: Returns the number of elements in a stack.
+ * - `bool is_empty(Handle stack) const`: Checks if a stack is empty.
+ * - `void push(Handle stack, T item)`: Adds an item to the top of a stack.
+ * - `T pop(Handle stack)`: Removes and returns the item at the top of a stack.
+ * - `void reset()`: Discards every stack.
+ * - `size_t memory_bytes() const`: Returns the bytes held for headers, blocks and free lists.
+*/
+
+#ifndef STACK_ARENA_H
+#define STACK_ARENA_H
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+using namespace std;
+
+
+#define ARENA_SIZE_CLASSES 27
+#define ARENA_INITIAL_BUFFER 1024
+
+// Allocates a buffer of `count` elements of T. Tests may define it before
+// including this header to make the buffer fail to grow.
+#ifndef STACK_ARENA_ALLOCATE
+#define STACK_ARENA_ALLOCATE(count) make_unique_for_overwrite<T[]>(count)
+#endif
+
+template <typename T>
+class StackArena {
+  static_assert(is_trivially_copyable_v<T>, "StackArena moves blocks bytewise");
+
+  // Class c holds 2^c elements; class 0 means the stack has no block yet.
+  struct Header {
+    uint32_t offset;
+    uint32_t size : 27;
+    uint32_t size_class : 5;
+  };
+
+  vector<Header> headers;
+  unique_ptr<T[]> buffer;
+  size_t buffer_capacity;
+  size_t buffer_used;
+  vector<uint32_t> free_blocks[ARENA_SIZE_CLASSES];
+
+public:
+  using Handle = uint32_t;
+
+  StackArena(): buffer_capacity(0), buffer_used(0) {
+  }
+
+  Handle create() {
+    if (headers.size() > UINT32_MAX) {
+      throw overflow_error("StackArena has run out of handles");
+    }
+    headers.push_back(Header{0, 0, 0});
+    return Handle(headers.size() - 1);
+  }
+
+  size_t stacks() const {
+    return headers.size();
+  }
+
+  size_t size(Handle stack) const {
+    return headers[stack].size;
+  }
+
+  bool is_empty(Handle stack) const {
+    return headers[stack].size == 0;
+  }
+
+  void push(Handle stack, T item) {
+    Header& header = headers[stack];
+    if (header.size == (size_t(1) << header.size_class) || header.size_class == 0) {
+      if (header.size_class + 1 == ARENA_SIZE_CLASSES) {
+        throw overflow_error("Stack has reached maximum capacity");
+      }
+      move_block(header, header.size_class + 1);
+    }
+    buffer[header.offset + header.size++] = item;
+  }
+
+  T pop(Handle stack) {
+    Header& header = headers[stack];
+    if (header.size == 0) {
+      throw underflow_error("cannot pop from empty stack");
+    }
+    T popped_value = buffer[header.offset + --header.size];
+    // Shrinking only saves memory, so a stack that cannot move to a smaller
+    // block keeps its larger one rather than losing the popped item.
+    try {
+      if (header.size == 0) {
+        move_block(header, 0);
+      } else if (header.size <= (size_t(1) << header.size_class) / 4) {
+        move_block(header, header.size_class - 1);
+      }
+    } catch (...) {
+    }
+    return popped_value;
+  }
+
+  void reset() {
+    headers.clear();
+    buffer_used = 0;
+    for (vector<uint32_t>& blocks : free_blocks) {
+      blocks.clear();
+    }
+  }
+
+  size_t memory_bytes() const {
+    size_t bytes = headers.capacity() * sizeof(Header) + buffer_capacity * sizeof(T);
+    for (const vector<uint32_t>& blocks : free_blocks) {
+      bytes += blocks.capacity() * sizeof(uint32_t);
+    }
+    return bytes;
+  }
+
+private:
+  // Gives the stack a block of the new class, or none for class 0, and
+  // releases its old block to the free list of its class. If it throws,
+  // the stack and the free lists are as they were.
+  void move_block(Header& header, unsigned new_class) {
+    // The old block is listed first, since that is the step that can fail
+    // once a new block has been taken; it cannot be handed straight back,
+    // as it is of a different class.
+    if (header.size_class != 0) {
+      free_blocks[header.size_class].push_back(header.offset);
+    }
+    uint32_t offset = 0;
+    try {
+      offset = new_class == 0 ? 0 : allocate_block(new_class);
+    } catch (...) {
+      if (header.size_class != 0) {
+        free_blocks[header.size_class].pop_back();
+      }
+      throw;
+    }
+    if (header.size_class != 0) {
+      copy(&buffer[header.offset], &buffer[header.offset] + header.size, &buffer[offset]);
+    }
+    header.offset = offset;
+    header.size_class = new_class;
+  }
+
+  uint32_t allocate_block(unsigned size_class) {
+    vector<uint32_t>& blocks = free_blocks[size_class];
+    if (!blocks.empty()) {
+      uint32_t offset = blocks.back();
+      blocks.pop_back();
+      return offset;
+    }
+    size_t block_size = size_t(1) << size_class;
+    if (buffer_used + block_size > buffer_capacity) {
+      grow_buffer(buffer_used + block_size);
+    }
+    uint32_t offset = uint32_t(buffer_used);
+    buffer_used += block_size;
+    return offset;
+  }
+
+  void grow_buffer(size_t needed) {
+    if (needed > size_t(UINT32_MAX) + 1) {
+      throw overflow_error("StackArena has run out of 32-bit offsets");
+    }
+    size_t new_capacity = max(size_t(ARENA_INITIAL_BUFFER), buffer_capacity);
+    while (new_capacity < needed) {
+      new_capacity *= 2;
+    }
+    new_capacity = min(new_capacity, size_t(UINT32_MAX) + 1);
+    unique_ptr<T[]> new_buffer = STACK_ARENA_ALLOCATE(new_capacity);
+    copy(buffer.get(), buffer.get() + buffer_used, new_buffer.get());
+    buffer = move(new_buffer);
+    buffer_capacity = new_capacity;
+  }
+};
+
+#endif
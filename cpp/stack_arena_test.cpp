@@ -0,0 +1,134 @@
+#include <iostream>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+#include <memory>
+#include <new>
+#include <vector>
+using namespace std;
+
+// Lets a test make the arena's buffer fail to grow, as when out of memory
+static bool fail_arena_growth = false;
+
+template <typename T>
+unique_ptr<T[]> allocate_arena_buffer(size_t count) {
+  if (fail_arena_growth) {
+    throw bad_alloc();
+  }
+  return make_unique_for_overwrite<T[]>(count);
+}
+
+#define STACK_ARENA_ALLOCATE(count) allocate_arena_buffer<T>(count)
+#include "stack_arena.h"
+
+// -----------------------------------------------------------------------------
+int passed = 0;
+int failed = 0;
+
+void expect(string description, bool condition) {
+  if (condition) passed++; else failed++;
+  cout << description << " " << (condition ? "PASS" : "FAIL") << endl;
+}
+// -----------------------------------------------------------------------------
+
+int main() {
+
+    StackArena<int> arena;
+    expect("New arena has no stacks", arena.stacks() == 0 && arena.memory_bytes() == 0);
+
+    // New stacks are empty and take no storage
+    auto a = arena.create();
+    auto b = arena.create();
+    expect("Handles are distinct", a != b && arena.stacks() == 2);
+    expect("New stack empty", arena.is_empty(a) && arena.size(a) == 0);
+    size_t before_push = arena.memory_bytes();
+    for (int i = 0; i < 1000; i++) arena.create();
+    expect("Empty stacks cost only their headers", arena.memory_bytes() - before_push <= 1000 * 8 * 2);
+
+    // Stacks are independent and last in, first out
+    for (int i = 0; i < 100; i++) {
+        arena.push(a, i);
+        arena.push(b, -i);
+    }
+    expect("Sizes after interleaved pushes", arena.size(a) == 100 && arena.size(b) == 100);
+    bool lifo = true;
+    for (int i = 99; i >= 0; i--) lifo = lifo && arena.pop(a) == i;
+    for (int i = 99; i >= 50; i--) lifo = lifo && arena.pop(b) == -i;
+    expect("Items come back in reverse order", lifo && arena.is_empty(a));
+    expect("Other stack keeps its items", arena.size(b) == 50 && arena.pop(b) == -49);
+
+    // Many stacks growing and shrinking at different rates keep their contents
+    vector<StackArena<long>::Handle> handles;
+    vector<vector<long>> reference(2000);
+    StackArena<long> many;
+    for (int i = 0; i < 2000; i++) handles.push_back(many.create());
+    unsigned seed = 7;
+    bool consistent = true;
+    for (int step = 0; step < 200000; step++) {
+        seed = seed * 1103515245 + 12345;
+        int which = (seed >> 8) % 2000;
+        if (reference[which].empty() || (seed >> 20) % 3 != 0) {
+            many.push(handles[which], step);
+            reference[which].push_back(step);
+        } else {
+            consistent = consistent && many.pop(handles[which]) == reference[which].back();
+            reference[which].pop_back();
+        }
+    }
+    for (int i = 0; i < 2000; i++) {
+        consistent = consistent && many.size(handles[i]) == reference[i].size();
+        while (!reference[i].empty()) {
+            consistent = consistent && many.pop(handles[i]) == reference[i].back();
+            reference[i].pop_back();
+        }
+    }
+    expect("Random pushes and pops across many stacks match vectors", consistent);
+
+    // Released blocks are reused rather than carved anew
+    size_t settled = many.memory_bytes();
+    for (int round = 0; round < 10; round++) {
+        for (int i = 0; i < 2000; i++) many.push(handles[i], i);
+        for (int i = 0; i < 2000; i++) many.pop(handles[i]);
+    }
+    expect("Recycled blocks keep memory steady", many.memory_bytes() == settled);
+
+    // Reset drops every stack at once
+    many.reset();
+    expect("Reset arena has no stacks", many.stacks() == 0);
+    auto fresh = many.create();
+    many.push(fresh, 42);
+    expect("Arena is usable after reset", many.pop(fresh) == 42 && many.is_empty(fresh));
+
+    // A stack that cannot get a smaller block keeps its larger one
+    StackArena<int> crowded;
+    auto big = crowded.create();
+    auto other = crowded.create();
+    for (int i = 0; i < 1024; i++) crowded.push(big, i);
+    // Takes the blocks big left behind, so shrinking big must grow the buffer
+    for (int i = 0; i < 512; i++) crowded.push(other, i);
+    fail_arena_growth = true;
+    bool kept_items = true;
+    try {
+        for (int i = 1023; i >= 256; i--) kept_items = crowded.pop(big) == i && kept_items;
+    } catch (bad_alloc& e) {
+        kept_items = false;
+    }
+    expect("Pop keeps its item when the stack cannot shrink", kept_items && crowded.size(big) == 256);
+    fail_arena_growth = false;
+    for (int i = 255; i >= 0; i--) kept_items = crowded.pop(big) == i && kept_items;
+    expect("Stack that could not shrink pops the rest in order", kept_items && crowded.is_empty(big));
+
+    // Popping an empty stack is an error
+    bool thrown = false;
+    try {
+        arena.pop(a);
+    } catch (underflow_error& e) {
+        thrown = true;
+        expect("Underflow exception message is correct",
+             string("cannot pop from empty stack") == e.what());
+    }
+    expect("Pop from empty stack should throw", thrown);
+
+    printf("\n%d passed, %d failed\n", passed, failed);
+    return 0;
+}
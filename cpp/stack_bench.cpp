@@ -0,0 +1,608 @@
+// Benchmarks for the stacks in this directory. Build with optimizations, e.g.
+//
+//     g++ -std=c++20 -O2 -DNDEBUG stack_bench.cpp && ./a.out
+//
+// The large-scale run needs a raised ceiling, e.g. for 2^31 elements:
+//
+//     g++ -std=c++20 -O2 -DMAX_CAPACITY=4294967296 stack_bench.cpp
+//     ./a.out large 2147483648
+//
+// and so does the growth run, which compares realloc with element copies
+// (2^27 ints by default):
+//
+//     ./a.out growth 134217728
+//
+// Each benchmark prints nanoseconds per operation for its configurations.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <malloc.h>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "stack.h"
+#include "external_stack.h"
+#include "persistent_stack.h"
+#include "aggregate_stack.h"
+#include "stack_queue.h"
+#include "stack_arena.h"
+#include "soa_stack.h"
+#include "compressed_stack.h"
+
+// -----------------------------------------------------------------------------
+template <typename Body>
+double time_ns(Body body) {
+  auto start = chrono::steady_clock::now();
+  body();
+  return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+}
+
+void report(const string& name, double elapsed_ns, double ops) {
+  printf("%-48s %8.2f ns/op\n", name.c_str(), elapsed_ns / ops);
+}
+// -----------------------------------------------------------------------------
+
+// Pushes far more than the memory budget, pops it all back, and reports the
+// sustained rate for several block sizes and budgets.
+void bench_external_stack() {
+  const size_t elements = size_t(1) << 24;
+  for (size_t budget : {size_t(8) << 20, size_t(32) << 20}) {
+    for (size_t block : {size_t(4096), size_t(65536), size_t(1) << 20}) {
+      if (block * sizeof(long) * 3 > budget) continue;
+      ExternalStack<long> s(block, budget);
+      long sum = 0;
+      double elapsed = time_ns([&] {
+        for (size_t i = 0; i < elements; i++) s.push(long(i));
+        while (!s.is_empty()) sum += s.pop();
+      });
+      report("ExternalStack block " + to_string(block) + ", budget " +
+        to_string(budget >> 20) + " MB", elapsed, 2.0 * elements);
+      if (sum != long(elements) * long(elements - 1) / 2) printf("wrong sum\n");
+    }
+  }
+}
+
+// Backtracking search: from a base state of some depth, fork many times,
+// extend each fork a little, then abandon it. Stack<T> cannot be copied,
+// so forking it means rebuilding element by element.
+Stack<int> clone(Stack<int>& source) {
+  vector<int> drained;
+  while (!source.is_empty()) drained.push_back(source.pop());
+  Stack<int> copy;
+  for (auto it = drained.rbegin(); it != drained.rend(); ++it) {
+    source.push(*it);
+    copy.push(*it);
+  }
+  return copy;
+}
+
+void bench_forks() {
+  const int forks = 20000;
+  const int extension = 8;
+  for (int depth : {16, 256, 4096}) {
+    Stack<int> base;
+    PersistentStack<int> persistent_base;
+    for (int i = 0; i < depth; i++) {
+      base.push(i);
+      persistent_base = persistent_base.push(i);
+    }
+    long sum = 0;
+    report("Stack<T> rebuild fork, depth " + to_string(depth), time_ns([&] {
+      for (int f = 0; f < forks; f++) {
+        Stack<int> fork = clone(base);
+        for (int i = 0; i < extension; i++) fork.push(f + i);
+        sum += fork.pop();
+      }
+    }), forks);
+    report("PersistentStack fork, depth " + to_string(depth), time_ns([&] {
+      for (int f = 0; f < forks; f++) {
+        PersistentStack<int> fork = persistent_base;
+        for (int i = 0; i < extension; i++) fork = fork.push(f + i);
+        sum += fork.peek();
+      }
+    }), forks);
+    if (sum == 1) printf("unreachable\n");
+  }
+}
+
+// A speculative parser: push a run of items, then abandon them, either one
+// pop at a time or with a single rollback to a mark.
+void bench_rollback() {
+  const int rounds = 20000;
+  const int speculative = 1000;
+  Stack<int> s;
+  long sum = 0;
+  report("pop back to saved depth", time_ns([&] {
+    for (int r = 0; r < rounds; r++) {
+      size_t depth = s.size();
+      for (int i = 0; i < speculative; i++) s.push(i);
+      while (s.size() > depth) sum += s.pop();
+    }
+  }), double(rounds) * speculative);
+  report("rollback to mark", time_ns([&] {
+    for (int r = 0; r < rounds; r++) {
+      size_t mark = s.mark();
+      for (int i = 0; i < speculative; i++) s.push(i);
+      s.rollback(mark);
+    }
+  }), double(rounds) * speculative);
+  if (sum == 1) printf("unreachable\n");
+}
+
+// Keeps a running minimum through push/pop churn, first with the usual second
+// stack holding the minimum below each item and then with an AggregateStack.
+void bench_aggregate_stack() {
+  const int rounds = 2000;
+  const int depth = 10000;
+  long sum = 0;
+  Stack<int> values;
+  Stack<int> minimums;
+  int current = numeric_limits<int>::max();
+  report("running min with two stacks", time_ns([&] {
+    for (int r = 0; r < rounds; r++) {
+      for (int i = 0; i < depth; i++) {
+        int item = (i * 7919) % depth;
+        minimums.push(current);
+        values.push(item);
+        current = min(current, item);
+      }
+      sum += current;
+      for (int i = 0; i < depth; i++) {
+        sum += values.pop();
+        current = minimums.pop();
+      }
+    }
+  }), double(rounds) * depth * 2);
+  AggregateStack<int, MinMonoid<int>> aggregated;
+  report("running min with AggregateStack", time_ns([&] {
+    for (int r = 0; r < rounds; r++) {
+      for (int i = 0; i < depth; i++) {
+        aggregated.push((i * 7919) % depth);
+      }
+      sum += aggregated.aggregate();
+      for (int i = 0; i < depth; i++) {
+        sum += aggregated.pop();
+      }
+    }
+  }), double(rounds) * depth * 2);
+  if (sum == 1) printf("unreachable\n");
+}
+
+// Streams events through a fixed-size window, reading the window's aggregate
+// after every event, then reports the slowest single event of a shorter run
+// with a window big enough for the amortized queue's transfers to show.
+template <typename Queue>
+void bench_window(const string& name, Queue& queue, long events, size_t window) {
+  long sum = 0;
+  unsigned seed = 1;
+  report(name, time_ns([&] {
+    for (long i = 0; i < events; i++) {
+      seed = seed * 1103515245 + 12345;
+      queue.push(int(seed >> 12));
+      if (queue.size() > window) sum += queue.pop();
+      sum += queue.aggregate();
+    }
+  }), double(events));
+  if (sum == 1) printf("unreachable\n");
+}
+
+// Preemption makes the single slowest event meaningless here, so this reports
+// the tenth slowest, which still catches a transfer recurring every window.
+template <typename Queue>
+void bench_worst_event(const string& name, Queue& queue, long events, size_t window) {
+  vector<double> latencies;
+  latencies.reserve(events);
+  long sum = 0;
+  // Fill the window untimed first, so first-touch page faults are not counted
+  for (size_t i = 0; i < 2 * window; i++) {
+    queue.push(0);
+    if (queue.size() > window) sum += queue.pop();
+  }
+  for (long i = 0; i < events; i++) {
+    latencies.push_back(time_ns([&] {
+      queue.push(int(i));
+      if (queue.size() > window) sum += queue.pop();
+      sum += queue.aggregate();
+    }));
+  }
+  sort(latencies.begin(), latencies.end());
+  printf("%-48s %8.0f ns\n", name.c_str(), latencies[events - 10]);
+  if (sum == 1) printf("unreachable\n");
+}
+
+void bench_stack_queues() {
+  const long events = 100000000;
+  const size_t window = 1000;
+  StackQueue<long, MaxMonoid<long>> amortized_max;
+  bench_window("rolling max, StackQueue", amortized_max, events, window);
+  StackQueue<long, SumMonoid<long>> amortized_sum;
+  bench_window("rolling sum, StackQueue", amortized_sum, events, window);
+  DeamortizedStackQueue<long, MaxMonoid<long>> deamortized_max(window + 1);
+  bench_window("rolling max, DeamortizedStackQueue", deamortized_max, events, window);
+  DeamortizedStackQueue<long, SumMonoid<long>> deamortized_sum(window + 1);
+  bench_window("rolling sum, DeamortizedStackQueue", deamortized_sum, events, window);
+
+  const size_t large_window = 30000;
+  StackQueue<long, SumMonoid<long>> amortized_large;
+  bench_worst_event("10th slowest event, StackQueue", amortized_large, 1000000, large_window);
+  DeamortizedStackQueue<long, SumMonoid<long>> deamortized_large(large_window + 1);
+  bench_worst_event("10th slowest event, DeamortizedStackQueue", deamortized_large, 1000000, large_window);
+}
+
+// One stack per vertex of a large graph: creates them all, pushes to and then
+// pops from randomly chosen ones, and reports heap bytes per stack.
+template <typename Create, typename Push, typename Pop>
+void bench_many_stacks(const string& name, size_t stacks, Create create, Push push, Pop pop) {
+  const long operations = 20000000;
+  auto heap_bytes = [] { return mallinfo2().uordblks + mallinfo2().hblkhd; };
+  size_t heap_before = heap_bytes();
+  report(name + " create", time_ns(create), double(stacks));
+  printf("%-48s %8.1f bytes/stack\n", (name + " memory, empty").c_str(),
+    double(heap_bytes() - heap_before) / double(stacks));
+  long sum = 0;
+  unsigned seed = 1;
+  report(name + " push", time_ns([&] {
+    for (long i = 0; i < operations; i++) {
+      seed = seed * 1103515245 + 12345;
+      push(size_t(seed) % stacks, int(i));
+    }
+  }), double(operations));
+  printf("%-48s %8.1f bytes/stack\n", (name + " memory, after pushes").c_str(),
+    double(heap_bytes() - heap_before) / double(stacks));
+  seed = 1;
+  report(name + " pop", time_ns([&] {
+    for (long i = 0; i < operations; i++) {
+      seed = seed * 1103515245 + 12345;
+      sum += pop(size_t(seed) % stacks);
+    }
+  }), double(operations));
+  if (sum == 1) printf("unreachable\n");
+}
+
+void bench_stack_arena() {
+  const size_t stacks = 10000000;
+  {
+    vector<Stack<int>> separate;
+    bench_many_stacks("vector<Stack<int>>", stacks,
+      [&] { separate = vector<Stack<int>>(stacks); },
+      [&](size_t v, int item) { separate[v].push(item); },
+      [&](size_t v) { return separate[v].pop(); });
+  }
+  // Handles are handed out in order, so vertex v's stack is handle v
+  StackArena<int> arena;
+  bench_many_stacks("StackArena<int>", stacks,
+    [&] { for (size_t v = 0; v < stacks; v++) arena.create(); },
+    [&](size_t v, int item) { arena.push(StackArena<int>::Handle(v), item); },
+    [&](size_t v) { return arena.pop(StackArena<int>::Handle(v)); });
+  report("StackArena<int> reset", time_ns([&] { arena.reset(); }), 1);
+}
+
+// Sums the int field of a full stack of (int, string) items, over the
+// interleaved layout Stack<pair<int, string>> keeps and over SoAStack's field
+// view, then drains both stacks. At the default MAX_CAPACITY both layouts fit
+// in cache; the bandwidth gap shows with e.g. -O3 -DMAX_CAPACITY=4194304.
+void bench_soa_stack() {
+  const size_t depth = MAX_CAPACITY;
+  const int scans = 5000;
+  Stack<pair<int, string>> interleaved;
+  SoAStack<int, string> split;
+  // Stack has no view of its buffer, so the scan runs over a copy of the
+  // array it keeps, in the same layout
+  auto interleaved_copy = make_unique<pair<int, string>[]>(depth);
+  for (size_t i = 0; i < depth; i++) {
+    interleaved.push(make_pair(int(i), "payload " + to_string(i)));
+    split.push(int(i), "payload " + to_string(i));
+    interleaved_copy[i] = make_pair(int(i), "payload " + to_string(i));
+  }
+  long sum = 0;
+  double elapsed = time_ns([&] {
+    for (int s = 0; s < scans; s++) {
+      for (size_t i = 0; i < depth; i++) sum += interleaved_copy[i].first;
+      // Keep the compiler from folding repeated scans of unchanged memory
+      asm volatile("" : : : "memory");
+    }
+  });
+  report("int field scan, interleaved pairs", elapsed, double(scans) * depth);
+  printf("%-48s %8.2f GB/s\n", "  useful bandwidth", double(scans) * depth * sizeof(int) / elapsed);
+  elapsed = time_ns([&] {
+    for (int s = 0; s < scans; s++) {
+      for (int number : split.field<0>()) sum += number;
+      asm volatile("" : : : "memory");
+    }
+  });
+  report("int field scan, SoAStack", elapsed, double(scans) * depth);
+  printf("%-48s %8.2f GB/s\n", "  useful bandwidth", double(scans) * depth * sizeof(int) / elapsed);
+  report("drain, Stack<pair<int, string>>", time_ns([&] {
+    while (!interleaved.is_empty()) sum += interleaved.pop().first;
+  }), double(depth));
+  report("drain, SoAStack<int, string>", time_ns([&] {
+    while (!split.is_empty()) sum += get<0>(split.pop());
+  }), double(depth));
+  if (sum == 1) printf("unreachable\n");
+}
+
+// Backtracking over decision flags: fills a stack of flags to the ceiling
+// and unwinds it, one flag at a time, as bytes and as packed bits, then
+// 64 flags at a time with pop_n.
+void bench_flags() {
+  const int rounds = 2000;
+  const size_t depth = MAX_CAPACITY;
+  long sum = 0;
+  Stack<unsigned char> bytes;
+  report("flags as bytes, push and pop", time_ns([&] {
+    for (int r = 0; r < rounds; r++) {
+      for (size_t i = 0; i < depth; i++) bytes.push((i * 7919) % 3 == 0);
+      while (!bytes.is_empty()) sum += bytes.pop();
+    }
+  }), 2.0 * rounds * depth);
+  Stack<bool> bits;
+  report("Stack<bool>, push and pop", time_ns([&] {
+    for (int r = 0; r < rounds; r++) {
+      for (size_t i = 0; i < depth; i++) bits.push((i * 7919) % 3 == 0);
+      while (!bits.is_empty()) sum += bits.pop();
+    }
+  }), 2.0 * rounds * depth);
+  report("Stack<bool>, push and pop_n(64)", time_ns([&] {
+    for (int r = 0; r < rounds; r++) {
+      for (size_t i = 0; i < depth; i++) bits.push((i * 7919) % 3 == 0);
+      while (bits.size() >= 64) sum += __builtin_popcountll(bits.pop_n(64));
+      sum += bits.pop_n(bits.size());
+    }
+  }), 2.0 * rounds * depth);
+  printf("%-48s %8zu vs %zu bytes\n", "buffer at full depth, bytes vs bits",
+    depth * sizeof(unsigned char), (depth / 64 + 1) * sizeof(uint64_t));
+  if (sum == 1) printf("unreachable\n");
+}
+
+// Compresses 10^7 64-bit values of three shapes, reporting the ratio of raw
+// to compressed bytes and the cost of pushing, popping and draining them.
+void bench_compressed_stack() {
+  const size_t count = 10000000;
+  vector<int64_t> monotone(count), random(count), clustered(count);
+  uint64_t seed = 1;
+  int64_t offset = 0;
+  int64_t center = 0;
+  for (size_t i = 0; i < count; i++) {
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    monotone[i] = offset += int64_t(seed >> 58);
+    random[i] = int64_t(seed);
+    if (seed % 1000 == 0) center = int64_t(seed >> 20);
+    clustered[i] = center + int64_t((seed >> 40) % 200) - 100;
+  }
+  vector<int64_t> drained;
+  drained.reserve(count);
+  for (auto [name, values] : {pair<string, vector<int64_t>*>{"monotone", &monotone},
+                              pair<string, vector<int64_t>*>{"random", &random},
+                              pair<string, vector<int64_t>*>{"clustered", &clustered}}) {
+    CompressedStack<int64_t> stack;
+    long sum = 0;
+    report("CompressedStack push, " + name, time_ns([&] {
+      for (int64_t value : *values) stack.push(value);
+    }), double(count));
+    printf("%-48s %8.2f x\n", ("  compression ratio, " + name).c_str(),
+      double(count * sizeof(int64_t)) / double(stack.compressed_bytes()));
+    report("CompressedStack pop, " + name, time_ns([&] {
+      for (size_t i = 0; i < count / 2; i++) sum += stack.pop();
+    }), double(count / 2));
+    // The output vector is reused, so drains after the first are not
+    // measuring page faults
+    drained.clear();
+    report("CompressedStack drain, " + name, time_ns([&] {
+      stack.drain(drained);
+    }), double(count - count / 2));
+    sum += drained.back();
+    if (sum == 1) printf("unreachable\n");
+  }
+}
+
+// Pushes `count` one-byte elements, then pops them all.
+void bench_large_scale(size_t count) {
+  if (count > size_t(MAX_CAPACITY)) {
+    printf("MAX_CAPACITY is %zu; rebuild with a larger -DMAX_CAPACITY\n", size_t(MAX_CAPACITY));
+    return;
+  }
+  Stack<char> s;
+  report("Stack<char> large-scale push", time_ns([&] {
+    for (size_t i = 0; i < count; i++) s.push(char(i));
+  }), double(count));
+  long sum = 0;
+  report("Stack<char> large-scale pop", time_ns([&] {
+    while (!s.is_empty()) sum += s.pop();
+  }), double(count));
+  if (sum == 1) printf("unreachable\n");
+}
+
+// The inner step of a stack VM, checked and unchecked. They are kept out of
+// line so that their code can be compared with e.g.
+//
+//     objdump -d --no-show-raw-insn a.out | c++filt | grep -A20 vm_step
+__attribute__((noinline)) void vm_step_checked(Stack<long>& s, long operand) {
+  s.push(operand);
+  s.push(s.pop() + s.pop());
+}
+
+__attribute__((noinline)) void vm_step_unchecked(Stack<long>& s, long operand) {
+  s.push_unchecked(operand);
+  s.push_unchecked(s.pop_unchecked() + s.pop_unchecked());
+}
+
+void bench_unchecked() {
+  const long steps = 200000000;
+  Stack<long> s;
+  s.push(0);
+  s.push(0);
+  s.pop_unchecked();
+  report("VM step, checked push/pop", time_ns([&] {
+    for (long i = 0; i < steps; i++) vm_step_checked(s, i);
+  }), double(steps));
+  report("VM step, unchecked push/pop", time_ns([&] {
+    for (long i = 0; i < steps; i++) vm_step_unchecked(s, i);
+  }), double(steps));
+  if (s.pop() == 1) printf("unreachable\n");
+}
+
+// An int that Stack must copy element by element, since its copy
+// constructor is user-provided.
+struct CopiedInt {
+  int value;
+  CopiedInt(int value = 0): value(value) {}
+  CopiedInt(const CopiedInt& other): value(other.value) {}
+  CopiedInt& operator=(const CopiedInt& other) = default;
+  explicit operator int() const { return value; }
+};
+
+// Grows a stack of `count` ints from empty and shrinks it back, once with
+// realloc and once copying every element on each resize.
+void bench_growth(size_t count) {
+  if (count > size_t(MAX_CAPACITY)) {
+    printf("MAX_CAPACITY is %zu; rebuild with a larger -DMAX_CAPACITY\n", size_t(MAX_CAPACITY));
+    return;
+  }
+  long sum = 0;
+  {
+    Stack<int> relocated;
+    report("Stack<int> growth, realloc", time_ns([&] {
+      for (size_t i = 0; i < count; i++) relocated.push(int(i));
+    }), double(count));
+    report("Stack<int> shrink, realloc", time_ns([&] {
+      while (!relocated.is_empty()) sum += relocated.pop();
+    }), double(count));
+  }
+  {
+    Stack<CopiedInt> copied;
+    report("Stack<CopiedInt> growth, element copies", time_ns([&] {
+      for (size_t i = 0; i < count; i++) copied.push(CopiedInt(int(i)));
+    }), double(count));
+    report("Stack<CopiedInt> shrink, element copies", time_ns([&] {
+      while (!copied.is_empty()) sum += copied.pop().value;
+    }), double(count));
+  }
+  if (sum == 1) printf("unreachable\n");
+}
+
+// Grows and shrinks a stack of strings too long for the small-string buffer,
+// so that every copy made while resizing allocates.
+void bench_string_stack() {
+  const int rounds = 200;
+  const size_t depth = MAX_CAPACITY;
+  string payload(48, 'x');
+  long sum = 0;
+  Stack<string> strings;
+  report("Stack<string> fill and drain", time_ns([&] {
+    for (int r = 0; r < rounds; r++) {
+      for (size_t i = 0; i < depth; i++) strings.push(payload);
+      while (!strings.is_empty()) sum += strings.pop().size();
+    }
+  }), 2.0 * rounds * depth);
+  if (sum == 1) printf("unreachable\n");
+}
+
+// Creates a million stacks of strings that are never pushed to, then
+// creates and destroys as many again with one in eight pushed to once.
+void bench_unused_stacks() {
+  const size_t stacks = 1000000;
+  auto heap_bytes = [] { return mallinfo2().uordblks + mallinfo2().hblkhd; };
+  size_t heap_before = heap_bytes();
+  {
+    vector<Stack<string>> unused;
+    report("Stack<string> startup, never pushed", time_ns([&] {
+      unused.resize(stacks);
+    }), double(stacks));
+    printf("%-48s %8.1f bytes/stack\n", "Stack<string> startup memory",
+      double(heap_bytes() - heap_before) / double(stacks));
+  }
+  string payload = "request";
+  long sum = 0;
+  report("Stack<string> churn, 1 in 8 pushed", time_ns([&] {
+    for (size_t i = 0; i < stacks; i++) {
+      Stack<string> scratch;
+      if (i % 8 == 0) {
+        scratch.push(payload);
+        sum += scratch.pop().size();
+      }
+      sum += scratch.size();
+    }
+  }), double(stacks));
+  if (sum == 1) printf("unreachable\n");
+}
+
+// Creates a stack of strings per request, fills it to a depth between 1 and
+// 512, drains it and destroys it, with the buffer pool off and then on, and
+// reports nanoseconds per request. The strings are short enough to live in
+// the small-string buffer, so the stack's own buffers are the only allocations.
+void bench_request_stacks() {
+  const long requests = 500000;
+  long sum = 0;
+  auto run = [&] {
+    unsigned seed = 1;
+    return time_ns([&] {
+      for (long r = 0; r < requests; r++) {
+        seed = seed * 1103515245 + 12345;
+        size_t depth = 1 + (seed >> 16) % 512;
+        Stack<string> scratch;
+        for (size_t i = 0; i < depth; i++) scratch.push("token");
+        while (!scratch.is_empty()) sum += scratch.pop().size();
+      }
+    });
+  };
+  report("request-scoped Stack<string>, no pool", run(), double(requests));
+  StackBufferPool::set_limit(1 << 20);
+  report("request-scoped Stack<string>, 1 MB pool", run(), double(requests));
+  StackBufferPool::set_limit(0);
+  if (sum == 1) printf("unreachable\n");
+}
+
+// Fills a stack to MAX_CAPACITY and drains it, over and over, once letting it
+// grow and shrink and once with the buffer reserved at construction.
+template <typename T>
+void bench_reserved(const string& name) {
+  const int rounds = 200;
+  const size_t depth = MAX_CAPACITY;
+  long sum = 0;
+  Stack<T> grown;
+  report(name + " fill and drain, default", time_ns([&] {
+    for (int r = 0; r < rounds; r++) {
+      for (size_t i = 0; i < depth; i++) grown.push(T(int(i)));
+      while (!grown.is_empty()) sum += int(grown.pop());
+    }
+  }), 2.0 * rounds * depth);
+  Stack<T> sized(depth);
+  report(name + " fill and drain, reserved", time_ns([&] {
+    for (int r = 0; r < rounds; r++) {
+      for (size_t i = 0; i < depth; i++) sized.push(T(int(i)));
+      while (!sized.is_empty()) sum += int(sized.pop());
+    }
+  }), 2.0 * rounds * depth);
+  if (sum == 1) printf("unreachable\n");
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1 && strcmp(argv[1], "large") == 0) {
+    bench_large_scale(argc > 2 ? strtoull(argv[2], nullptr, 10) : size_t(1) << 31);
+    return 0;
+  }
+  if (argc > 1 && strcmp(argv[1], "growth") == 0) {
+    bench_growth(argc > 2 ? strtoull(argv[2], nullptr, 10) : size_t(1) << 27);
+    return 0;
+  }
+  bench_external_stack();
+  bench_forks();
+  bench_rollback();
+  bench_aggregate_stack();
+  bench_stack_queues();
+  bench_stack_arena();
+  bench_soa_stack();
+  bench_flags();
+  bench_compressed_stack();
+  bench_string_stack();
+  bench_unused_stacks();
+  bench_request_stacks();
+  bench_reserved<int>("Stack<int>");
+  bench_reserved<CopiedInt>("Stack<CopiedInt>");
+  bench_unchecked();
+  return 0;
+}
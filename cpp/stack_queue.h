@@ -0,0 +1,242 @@
+/**
+ * @class StackQueue
+ * @brief A FIFO queue made of two stacks that reports the aggregate of its contents in O(1).
+ *
+ * This is the two-stacks queue used for sliding-window aggregation. Items are pushed onto a
+ * back stack, and the running aggregate of that stack is kept in a member. Items are popped
+ * from a front stack whose entries each hold the aggregate of themselves and every newer
+ * entry beneath them. When the front runs dry, the whole back stack is moved across in one
+ * pass, reversing it into pop order and computing those aggregates on the way. The window's
+ * aggregate is always the front's aggregate combined with the back's.
+ *
+ * @tparam T The type of elements to store in the queue.
+ * @tparam Monoid The operation to aggregate with, as for `AggregateStack`. It need only be
+ *         associative, not commutative: aggregates are combined oldest to newest.
+ *
+ * ## Key Features:
+ * - **O(1) Amortized**: Each item is moved from the back stack to the front stack once.
+ * - **O(1) Queries**: `aggregate()` combines two stored values.
+ * - **Exception Safety**: Popping an empty queue throws `std::underflow_error`; pushing
+ *   past `MAX_CAPACITY` items on either stack throws `std::overflow_error`.
+ *
+ * ## Constraints:
+ * - A pop that finds the front empty moves every item in the back stack, so a single pop can
+ *   take time proportional to the window. `DeamortizedStackQueue` bounds that.
+ *
+ * ## Public Methods:
+ * - `StackQueue()`: Constructs an empty queue, whose aggregate is the identity.
+ * - `size_t size() const`: Returns the current number of elements in the queue.
+ * - `bool is_empty() const`: Checks if the queue is empty.
+ * - `void push(T item)`: Adds an item at the back of the queue.
+ * - `T pop()`: Removes and returns the item at the front of the queue.
+ * - `T aggregate() const`: Returns the combination of all items, oldest to newest.
+*/
+
+/**
+ * @class DeamortizedStackQueue
+ * @brief A `StackQueue` whose every operation does O(1) work in the worst case.
+ *
+ * Instead of waiting for the front stack to run dry, a rebuild starts as soon as the back
+ * stack holds more items than the front. The back stack is set aside and a new front is
+ * built next to the old one, two steps per push or pop: first the set-aside back is popped
+ * onto it, then the old front's surviving items are copied above those, bottom up. Pops keep
+ * coming from the old front meanwhile, and since it held nearly as many items as were set
+ * aside, the new front is always complete before the old one empties. During a rebuild the
+ * aggregate is the old front's, then the set-aside back's, then the new back's.
+ *
+ * @tparam T The type of elements to store in the queue.
+ * @tparam Monoid The operation to aggregate with, as for `StackQueue`.
+ *
+ * ## Key Features:
+ * - **O(1) Worst Case**: No operation moves more than two items. Stacks are preallocated to
+ *   the capacity given at construction, so a window that stays within it never reallocates
+ *   either.
+ * - **O(1) Queries**: `aggregate()` combines at most three stored values.
+ * - **Exception Safety**: Popping an empty queue throws `std::underflow_error`.
+ *
+ * ## Constraints:
+ * - The old front is copied by index, so this variant keeps its stacks in vectors rather
+ *   than `Stack`. Windows larger than the reserved capacity still work, but the growth of a
+ *   vector is then an O(n) step.
+ *
+ * ## Public Methods:
+ * - `DeamortizedStackQueue(size_t capacity)`: Constructs an empty queue with room for
+ *   `capacity` items before any reallocation.
+ * - `size_t size() const`, `bool is_empty() const`, `void push(T item)`, `T pop()` and
+ *   `T aggregate() const`: As for `StackQueue`.
+*/
+
+#ifndef STACK_QUEUE_H
+#define STACK_QUEUE_H
+
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "stack.h"
+#include "aggregate_stack.h"
+using namespace std;
+
+
+template <typename T, typename Monoid>
+class StackQueue {
+  struct Entry {
+    T value;
+    T newer;
+  };
+
+  Stack<Entry> front;
+  T front_total;
+  Stack<T> back;
+  T back_total;
+
+public:
+  StackQueue(): front_total(Monoid::identity()), back_total(Monoid::identity()) {
+  }
+
+  size_t size() const {
+    return front.size() + back.size();
+  }
+
+  bool is_empty() const {
+    return front.is_empty() && back.is_empty();
+  }
+
+  void push(T item) {
+    T combined = Monoid::combine(back_total, item);
+    back.push(move(item));
+    back_total = move(combined);
+  }
+
+  T pop() {
+    if (is_empty()) {
+      throw underflow_error("cannot pop from empty queue");
+    }
+    if (front.is_empty()) {
+      // The newest item goes to the bottom, so the oldest ends up on top
+      while (!back.is_empty()) {
+        T item = back.pop();
+        T combined = Monoid::combine(item, front_total);
+        front.push(Entry{move(item), move(front_total)});
+        front_total = move(combined);
+      }
+      back_total = Monoid::identity();
+    }
+    Entry entry = front.pop();
+    front_total = move(entry.newer);
+    return move(entry.value);
+  }
+
+  T aggregate() const {
+    return Monoid::combine(front_total, back_total);
+  }
+};
+
+template <typename T, typename Monoid>
+class DeamortizedStackQueue {
+  struct Entry {
+    T value;
+    T total;
+  };
+
+  vector<Entry> front;
+  vector<T> back;
+  T back_total;
+
+  bool rebuilding;
+  vector<T> old_back;
+  T old_back_total;
+  vector<Entry> rebuilt;
+  size_t copied;
+
+public:
+  DeamortizedStackQueue(size_t capacity = INITIAL_CAPACITY):
+    back_total(Monoid::identity()),
+    rebuilding(false),
+    old_back_total(Monoid::identity()),
+    copied(0) {
+    front.reserve(capacity);
+    back.reserve(capacity);
+    old_back.reserve(capacity);
+    rebuilt.reserve(capacity);
+  }
+
+  size_t size() const {
+    // Items the rebuild has moved out of the set-aside back are only in the new front
+    return front.size() + old_back.size() + (rebuilt.size() - copied) + back.size();
+  }
+
+  bool is_empty() const {
+    return size() == 0;
+  }
+
+  void push(T item) {
+    step();
+    step();
+    T combined = Monoid::combine(back_total, item);
+    back.push_back(move(item));
+    back_total = move(combined);
+    start_rebuild_if_due();
+  }
+
+  T pop() {
+    if (is_empty()) {
+      throw underflow_error("cannot pop from empty queue");
+    }
+    step();
+    step();
+    T popped_value = move(front.back().value);
+    front.pop_back();
+    finish_rebuild_if_done();
+    start_rebuild_if_due();
+    return popped_value;
+  }
+
+  T aggregate() const {
+    T front_total = front.empty() ? Monoid::identity() : front.back().total;
+    if (rebuilding) {
+      front_total = Monoid::combine(front_total, old_back_total);
+    }
+    return Monoid::combine(front_total, back_total);
+  }
+
+private:
+  void start_rebuild_if_due() {
+    if (!rebuilding && back.size() > front.size()) {
+      swap(back, old_back);
+      old_back_total = exchange(back_total, Monoid::identity());
+      rebuilding = true;
+    }
+  }
+
+  void push_rebuilt(const T& item) {
+    T total = rebuilt.empty() ? item : Monoid::combine(item, rebuilt.back().total);
+    rebuilt.push_back(Entry{item, move(total)});
+  }
+
+  // Moves one item into the new front: the set-aside back first, newest
+  // item first, then what is left of the old front, from its bottom up.
+  void step() {
+    if (!rebuilding) {
+      return;
+    }
+    if (!old_back.empty()) {
+      push_rebuilt(old_back.back());
+      old_back.pop_back();
+    } else if (copied < front.size()) {
+      push_rebuilt(front[copied++].value);
+    }
+    finish_rebuild_if_done();
+  }
+
+  void finish_rebuild_if_done() {
+    if (rebuilding && old_back.empty() && copied >= front.size()) {
+      swap(front, rebuilt);
+      rebuilt.clear();
+      copied = 0;
+      old_back_total = Monoid::identity();
+      rebuilding = false;
+    }
+  }
+};
+
+#endif
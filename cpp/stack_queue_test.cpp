@@ -0,0 +1,134 @@
+#include <iostream>
+#include <cassert>
+#include <deque>
+#include <stdexcept>
+#include <string>
+using namespace std;
+
+#include "stack_queue.h"
+
+// -----------------------------------------------------------------------------
+int passed = 0;
+int failed = 0;
+
+void expect(string description, bool condition) {
+  if (condition) passed++; else failed++;
+  cout << description << " " << (condition ? "PASS" : "FAIL") << endl;
+}
+// -----------------------------------------------------------------------------
+
+struct Concat {
+  static string identity() { return ""; }
+  static string combine(const string& a, const string& b) { return a + b; }
+};
+
+// Drives a queue through a random walk of pushes and pops and checks its
+// order and aggregate against a deque after every operation.
+template <typename Queue, typename Monoid>
+bool matches_deque(Queue& queue, int operations) {
+  deque<long> reference;
+  unsigned seed = 12345;
+  for (int i = 0; i < operations; i++) {
+    seed = seed * 1103515245 + 12345;
+    bool push = reference.empty() || (seed >> 16) % 5 < 3;
+    if (push) {
+      long item = (seed >> 8) % 1000;
+      queue.push(item);
+      reference.push_back(item);
+    } else {
+      if (queue.pop() != reference.front()) return false;
+      reference.pop_front();
+    }
+    long expected = Monoid::identity();
+    for (long item : reference) expected = Monoid::combine(expected, item);
+    if (queue.size() != reference.size() || queue.aggregate() != expected) return false;
+  }
+  return true;
+}
+
+int main() {
+
+    StackQueue<int, SumMonoid<int>> sums;
+    expect("New queue empty", sums.is_empty() && sums.size() == 0);
+    expect("Empty queue aggregate is the identity", sums.aggregate() == 0);
+
+    // First in, first out, with the aggregate following both ends
+    sums.push(1);
+    sums.push(2);
+    sums.push(3);
+    expect("Sum after pushes", sums.aggregate() == 6 && sums.size() == 3);
+    expect("Pop returns the oldest item", sums.pop() == 1);
+    expect("Sum after pop", sums.aggregate() == 5);
+    sums.push(10);
+    expect("Sum spans both stacks", sums.aggregate() == 15);
+    expect("Order survives a transfer", sums.pop() == 2 && sums.pop() == 3 && sums.pop() == 10);
+
+    // Non-commutative monoids see the window oldest to newest
+    StackQueue<string, Concat> words;
+    words.push("a");
+    words.push("b");
+    words.push("c");
+    words.pop();
+    words.push("d");
+    expect("Aggregate is combined oldest to newest", words.aggregate() == "bcd");
+
+    // A sliding window keeps a rolling maximum
+    StackQueue<int, MaxMonoid<int>> window;
+    int values[] = {3, 1, 4, 1, 5, 9, 2, 6, 5, 3, 5};
+    bool rolling_max = true;
+    int expected_max[] = {4, 4, 5, 9, 9, 9, 6, 6, 5};
+    for (int i = 0; i < 11; i++) {
+        window.push(values[i]);
+        if (i >= 3) window.pop();
+        if (i >= 2) rolling_max = rolling_max && window.aggregate() == expected_max[i - 2];
+    }
+    expect("Rolling maximum over a window of three", rolling_max);
+
+    StackQueue<long, MinMonoid<long>> random_min;
+    expect("Random walk matches a deque", matches_deque<decltype(random_min), MinMonoid<long>>(random_min, 20000));
+
+    // The de-amortized queue behaves identically
+    DeamortizedStackQueue<long, SumMonoid<long>> deamortized_sum(64);
+    expect("De-amortized random walk matches a deque",
+        matches_deque<decltype(deamortized_sum), SumMonoid<long>>(deamortized_sum, 20000));
+    DeamortizedStackQueue<long, MaxMonoid<long>> deamortized_max;
+    expect("De-amortized random walk past its capacity matches a deque",
+        matches_deque<decltype(deamortized_max), MaxMonoid<long>>(deamortized_max, 20000));
+
+    DeamortizedStackQueue<string, Concat> deamortized_words;
+    bool in_order = true;
+    string expected_words;
+    for (int i = 0; i < 200; i++) {
+        string word(1, char('a' + i % 26));
+        deamortized_words.push(word);
+        expected_words += word;
+        if (i % 3 == 2) {
+            in_order = in_order && deamortized_words.pop() == expected_words.substr(0, 1);
+            expected_words.erase(0, 1);
+        }
+        in_order = in_order && deamortized_words.aggregate() == expected_words;
+    }
+    expect("De-amortized aggregate is combined oldest to newest", in_order);
+
+    // Popping an empty queue is an error
+    bool thrown = false;
+    try {
+        sums.pop();
+    } catch (underflow_error& e) {
+        thrown = true;
+        expect("Underflow exception message is correct",
+             string("cannot pop from empty queue") == e.what());
+    }
+    expect("Pop from empty queue should throw", thrown);
+    thrown = false;
+    try {
+        DeamortizedStackQueue<int, SumMonoid<int>> empty;
+        empty.pop();
+    } catch (underflow_error& e) {
+        thrown = true;
+    }
+    expect("Pop from empty de-amortized queue should throw", thrown);
+
+    printf("\n%d passed, %d failed\n", passed, failed);
+    return 0;
+}
@@ -1,11 +1,28 @@
 #include <iostream>
 #include <cassert>
 #include <cmath>
+#include <cstdint>
+#include <memory>
+#include <new>
 #include <stdexcept>
 #include <string>
 #include <utility>
+#include <vector>
 using namespace std;
 
+// Makes the next allocation of Stack<bool> words fail, as it would when out
+// of memory.
+static bool fail_next_words = false;
+
+unique_ptr<uint64_t[]> allocate_words(size_t count) {
+  if (fail_next_words) {
+    fail_next_words = false;
+    throw bad_alloc();
+  }
+  return make_unique<uint64_t[]>(count);
+}
+
+#define STACK_ALLOCATE_WORDS(count) allocate_words(count)
 #include "stack.h"
 
 // -----------------------------------------------------------------------------
@@ -18,6 +35,39 @@ void expect(string description, bool condition) {
 }
 // -----------------------------------------------------------------------------
 
+// Counts live instances, and has a user-provided copy, so Stack copies it.
+struct Counted {
+  static inline int live = 0;
+  int value;
+  Counted(int value = 0): value(value) { live++; }
+  Counted(const Counted& other): value(other.value) { live++; }
+  Counted& operator=(const Counted& other) = default;
+  ~Counted() { live--; }
+};
+
+// Copying throws once `copies_left` runs out, and moving may throw, so
+// Stack has to resize it by copying.
+struct Fragile {
+  static inline int copies_left = 1 << 30;
+  int value;
+  Fragile(int value = 0): value(value) {}
+  Fragile(const Fragile& other): value(other.value) {
+    if (copies_left-- == 0) throw runtime_error("copy failed");
+  }
+  Fragile(Fragile&& other): value(other.value) {}
+  Fragile& operator=(const Fragile& other) = default;
+};
+
+// Records how it was constructed; its move cannot throw.
+struct Tracked {
+  static inline int copies = 0;
+  int value;
+  Tracked(int value = 0): value(value) {}
+  Tracked(const Tracked& other): value(other.value) { copies++; }
+  Tracked(Tracked&& other) noexcept: value(other.value) {}
+  Tracked& operator=(const Tracked& other) = default;
+};
+
 int main() {
 
     Stack<int> is;
@@ -98,16 +148,303 @@ int main() {
     // Stack<int> is3;
     // is3 = is;
 
-    // Next line should be compiler error if uncommented
-    // Stack<int> is4 = move(is);
+    // Rolling back to a mark discards everything pushed after it
+    ss.push("kept");
+    size_t checkpoint = ss.mark();
+    for (int i = 0; i < 1000; i++) ss.push("speculative");
+    ss.rollback(checkpoint);
+    expect("Rollback restores the marked depth", ss.size() == checkpoint);
+    expect("Rollback keeps items below the mark", ss.pop() == "kept");
+    size_t int_checkpoint = is.mark();
+    for (int i = 0; i < 5000; i++) is.push(i);
+    is.rollback(int_checkpoint);
+    expect("Rollback of trivial items restores the marked depth", is.is_empty());
+    is.push(42);
+    expect("Stack is usable after rollback", is.pop() == 42);
+    thrown = false;
+    try {
+        is.rollback(1);
+    } catch (out_of_range& e) {
+        thrown = true;
+    }
+    expect("Rollback to a mark above the top should throw", thrown);
 
-    // Next two lines should be compiler errors if uncommented
-    // Stack<int> is5;
-    // is5 = move(is);
+    // Moves transfer the elements and leave the source empty but usable
+    is.push(7);
+    is.push(8);
+    Stack<int> is4 = move(is);
+    expect("Move-constructed stack takes the elements", is4.size() == 2);
+    expect("Moved-from stack is empty", is.is_empty() && is.size() == 0);
+    expect("Moved-from stack is not full", !is.is_full());
+    is.push(9);
+    expect("Moved-from stack can be pushed again", is.size() == 1 && is.pop() == 9);
+    Stack<int> is5;
+    is5.push(1);
+    is5 = move(is4);
+    expect("Move-assigned stack takes the elements", is5.size() == 2 && is5.pop() == 8);
+    expect("Move-assigned-from stack is empty", is4.is_empty());
+    swap(is4, is5);
+    expect("Swapped stacks exchange elements", is4.size() == 1 && is5.is_empty());
+
+    // Stacks can be returned from functions and kept in containers
+    auto make_stack = [](string first) {
+        Stack<string> made;
+        made.push(first);
+        return made;
+    };
+    vector<Stack<string>> stacks;
+    for (int i = 0; i < 20; i++) stacks.push_back(make_stack(to_string(i)));
+    expect("Stacks survive being moved inside a vector",
+        stacks.size() == 20 && stacks[0].pop() == "0" && stacks[19].pop() == "19");
+
+    // Stack<bool> packs its flags but behaves like any other stack
+    Stack<bool> flags;
+    expect("New flag stack empty", flags.is_empty() && flags.size() == 0);
+    vector<bool> reference;
+    for (int i = 0; i < 1000; i++) {
+        bool flag = (i * 7919) % 3 == 0;
+        flags.push(flag);
+        reference.push_back(flag);
+    }
+    expect("Flag stack size after pushes", flags.size() == 1000);
+    bool same_flags = true;
+    for (int i = 999; i >= 500; i--) same_flags = same_flags && flags.pop() == reference[i];
+    expect("Flags come back in reverse order across words", same_flags);
+    uint64_t expected_bits = 0;
+    for (int i = 0; i < 64; i++) expected_bits |= uint64_t(reference[436 + i]) << i;
+    expect("pop_n returns 64 flags spanning two words", flags.pop_n(64) == expected_bits);
+    expected_bits = 0;
+    for (int i = 0; i < 5; i++) expected_bits |= uint64_t(reference[431 + i]) << i;
+    expect("pop_n returns the top flag in its highest bit", flags.pop_n(5) == expected_bits);
+    expect("pop_n of nothing is empty", flags.pop_n(0) == 0 && flags.size() == 431);
+    size_t flag_mark = flags.mark();
+    for (int i = 0; i < 10000; i++) flags.push(true);
+    flags.rollback(flag_mark);
+    expect("Flag stack rolls back", flags.size() == 431 && flags.pop() == reference[430]);
+    flags.push(false);
+    flags.push(true);
+    expect("Pushing overwrites stale flags", flags.pop_n(2) == 0b10);
+    thrown = false;
+    try {
+        Stack<bool> few;
+        few.push(true);
+        few.pop_n(2);
+    } catch (underflow_error& e) {
+        thrown = true;
+    }
+    expect("pop_n past the bottom should throw", thrown);
+    Stack<bool> moved_flags = move(flags);
+    expect("Flag stack moves", moved_flags.size() == 430 && flags.is_empty());
+    flags.push(true);
+    expect("Moved-from flag stack can be pushed again", flags.pop());
+
+    // A shrink that cannot allocate keeps the larger buffer and the popped flags
+    {
+        Stack<bool> sparse;
+        for (int i = 0; i < 1024; i++) sparse.push(i % 5 == 0);
+        while (sparse.size() > 257) sparse.pop();
+        fail_next_words = true;
+        bool popped = sparse.pop();
+        expect("Failed flag shrink still pops", !fail_next_words && popped == (256 % 5 == 0)
+            && sparse.size() == 256 && sparse.capacity() == 1024);
+        fail_next_words = true;
+        uint64_t bits = sparse.pop_n(10);
+        uint64_t expected = 0;
+        for (int i = 0; i < 10; i++) expected |= uint64_t((246 + i) % 5 == 0) << i;
+        expect("Failed flag shrink still pops many",
+            !fail_next_words && bits == expected && sparse.size() == 246);
+        size_t flag_mark = sparse.mark();
+        for (int i = 0; i < 2000; i++) sparse.push(true);
+        fail_next_words = true;
+        sparse.rollback(flag_mark);
+        expect("Failed flag shrink still rolls back", !fail_next_words && sparse.size() == 246 && sparse.pop() == (245 % 5 == 0));
+    }
+
+    // Trivially relocatable elements are resized with realloc
+    static_assert(trivially_relocatable_v<int> && trivially_relocatable_v<pair<int, double>>);
+    static_assert(trivially_relocatable_v<unique_ptr<int>>);
+    static_assert(!trivially_relocatable_v<Counted>);
+    Stack<unique_ptr<int>> owners;
+    for (int i = 0; i < 1000; i++) owners.push(make_unique<int>(i));
+    bool owned = true;
+    for (int i = 999; i >= 0; i--) owned = owned && *owners.pop() == i;
+    expect("Move-only elements survive growth and shrinking", owned && owners.is_empty());
+    Counted::live = 0;
+    {
+        Stack<Counted> counted;
+        for (int i = 0; i < 100; i++) counted.push(Counted(i));
+        for (int i = 0; i < 90; i++) counted.pop();
+        expect("Copied elements keep their values", counted.pop().value == 9);
+    }
+    expect("Every element constructed is destroyed", Counted::live == 0);
+
+    // Resizing moves elements whose move cannot throw
+    {
+        Stack<Tracked> tracked;
+        Tracked::copies = 0;
+        for (int i = 0; i < 1000; i++) tracked.push(Tracked(i));
+        while (tracked.size() > 1) tracked.pop();
+        expect("Resizing never copies nothrow-movable elements",
+            Tracked::copies == 0 && tracked.pop().value == 0);
+    }
+
+    // A copy that throws during growth leaves the stack as it was
+    {
+        Stack<Fragile> fragile;
+        for (int i = 0; i < INITIAL_CAPACITY; i++) fragile.push(Fragile(i));
+        Fragile::copies_left = INITIAL_CAPACITY / 2;
+        thrown = false;
+        try {
+            fragile.push(Fragile(-1));
+        } catch (runtime_error& e) {
+            thrown = true;
+        }
+        Fragile::copies_left = 1 << 30;
+        expect("Throwing copy during growth propagates", thrown);
+        expect("Failed growth leaves the size unchanged", fragile.size() == INITIAL_CAPACITY);
+        bool intact = true;
+        for (int i = INITIAL_CAPACITY - 1; i >= 0; i--) intact = intact && fragile.pop().value == i;
+        expect("Failed growth leaves every element intact", intact);
+
+        // A copy that throws during a shrink costs only the memory saving
+        for (int i = 0; i < 4 * INITIAL_CAPACITY; i++) fragile.push(Fragile(i));
+        while (fragile.size() > INITIAL_CAPACITY + 1) fragile.pop();
+        Fragile::copies_left = 0;
+        bool popped = fragile.pop().value == INITIAL_CAPACITY;
+        Fragile::copies_left = 1 << 30;
+        expect("Throwing copy during shrink still pops", popped && fragile.size() == INITIAL_CAPACITY);
+    }
+
+    // Unchecked operations work within a buffer the stack already has
+    {
+        Stack<int> vm;
+        for (int i = 0; i < 100; i++) vm.push(i);
+        while (!vm.is_empty()) vm.pop_unchecked();
+        for (int i = 0; i < 100; i++) vm.push_unchecked(i * 2);
+        bool unchecked = vm.size() == 100;
+        for (int i = 99; i >= 0; i--) unchecked = unchecked && vm.pop_unchecked() == i * 2;
+        expect("Unchecked push and pop within capacity", unchecked && vm.is_empty());
+        vm.push(1);
+        expect("Checked operations still work afterwards", vm.pop() == 1);
+        Stack<bool> vm_flags;
+        vm_flags.reserve(2);
+        vm_flags.push_unchecked(true);
+        vm_flags.push_unchecked(false);
+        expect("Unchecked flag push and pop",
+            !vm_flags.pop_unchecked() && vm_flags.pop_unchecked() && vm_flags.is_empty());
+    }
+
+    // A new stack allocates nothing until its first push
+    {
+        Stack<string> unused;
+        expect("New stack has no buffer", unused.capacity() == 0 && unused.is_empty());
+        thrown = false;
+        try {
+            unused.pop();
+        } catch (underflow_error& e) {
+            thrown = true;
+        }
+        expect("Pop from a stack that never allocated should throw", thrown);
+        unused.rollback(unused.mark());
+        unused.shrink_to_fit();
+        unused.push("first");
+        expect("First push allocates the initial capacity",
+            unused.capacity() == INITIAL_CAPACITY && unused.pop() == "first");
+        Stack<bool> unused_flags;
+        expect("New flag stack has no buffer",
+            unused_flags.capacity() == 0 && unused_flags.pop_n(0) == 0);
+        unused_flags.push(true);
+        expect("First flag push allocates a word", unused_flags.capacity() == 64 && unused_flags.pop());
+    }
+
+    // A stack sized up front keeps its buffer until asked to give it back
+    {
+        Stack<int> sized(1000);
+        expect("Capacity hint sizes the buffer", sized.capacity() == 1000 && sized.is_empty());
+        for (int i = 0; i < 1000; i++) sized.push(i);
+        for (int i = 0; i < 1000; i++) sized.pop();
+        size_t mark = sized.mark();
+        for (int i = 0; i < 500; i++) sized.push(i);
+        sized.rollback(mark);
+        expect("Reserved buffer survives pushes, pops and rollbacks", sized.capacity() == 1000);
+        sized.push(7);
+        sized.shrink_to_fit();
+        expect("shrink_to_fit releases the reservation",
+            sized.capacity() == INITIAL_CAPACITY && sized.pop() == 7);
+        sized.reserve(100);
+        sized.reserve(50);
+        expect("reserve never shrinks", sized.capacity() == 100);
+        thrown = false;
+        try {
+            sized.reserve(size_t(MAX_CAPACITY) + 1);
+        } catch (overflow_error& e) {
+            thrown = true;
+        }
+        expect("Reserving beyond MAX_CAPACITY should throw", thrown && sized.capacity() == 100);
+        Stack<bool> sized_flags(1000);
+        for (int i = 0; i < 1000; i++) sized_flags.push(i % 3 == 0);
+        sized_flags.pop_n(64);
+        while (sized_flags.size() > 1) sized_flags.pop();
+        expect("Reserved flag stack keeps its buffer",
+            sized_flags.capacity() == 1000 && sized_flags.pop());
+    }
+
+    // The buffer pool is off by default, and then keeps freed buffers within its limit
+    {
+        expect("Buffer pool is off by default", StackBufferPool::limit() == 0);
+        { Stack<string> scratch; scratch.push("unpooled"); }
+        expect("Buffer pool keeps nothing while off", StackBufferPool::retained_bytes() == 0);
+        StackBufferPool::set_limit(1 << 16);
+        // Pushes 100 items, returning the bytes of every buffer the stack held
+        auto fill = [](auto& request, auto make) {
+            using Item = decltype(make(0));
+            size_t capacity = 0, bytes = 0;
+            for (int i = 0; i < 100; i++) {
+                request.push(make(i));
+                if (request.capacity() != capacity) {
+                    capacity = request.capacity();
+                    bytes += capacity * sizeof(Item);
+                }
+            }
+            return bytes;
+        };
+        auto make_string = [](int i) { return to_string(i); };
+        size_t held = 0;
+        {
+            Stack<string> request;
+            held = fill(request, make_string);
+        }
+        size_t retained = StackBufferPool::retained_bytes();
+        expect("Buffer pool keeps buffers freed by resizes and destructors", retained == held);
+        {
+            Stack<string> request;
+            fill(request, make_string);
+            expect("Buffer pool hands its buffers back out",
+                StackBufferPool::retained_bytes() == retained - request.capacity() * sizeof(string)
+                && request.pop() == "99");
+        }
+        expect("Buffer pool takes buffers back", StackBufferPool::retained_bytes() == retained);
+        {
+            Stack<pair<int, string>> request;
+            held = fill(request, [](int i) { return make_pair(i, to_string(i)); });
+        }
+        expect("Buffer pool keeps buffers of any element size",
+            StackBufferPool::retained_bytes() == retained + held);
+        {
+            Stack<int> large;
+            for (int i = 0; i < 20000; i++) large.push(i);
+            bool kept = true;
+            for (int i = 19999; i >= 0; i--) kept = kept && large.pop() == i;
+            expect("Relocatable elements survive pooled resizes", kept);
+        }
+        expect("Buffer pool stays within its limit", StackBufferPool::retained_bytes() <= (1 << 16));
+        StackBufferPool::set_limit(0);
+        expect("Turning the buffer pool off frees what it kept", StackBufferPool::retained_bytes() == 0);
+    }
 
     // Each of the next three lines should be compiler errors if uncommented
     // cout << ss.top;
-    // cout << ss.capacity;
+    // cout << ss.allocated;
     // cout << ss.elements;
     // ss.reallocate(128);
 